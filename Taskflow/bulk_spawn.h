@@ -0,0 +1,63 @@
+#pragma once
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+#include "taskflow/algorithm/for_each.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+/// How spawnChunked splits the items among the workers.
+enum class Partitioning
+{
+	/// Chunks start large, a share of what remains, and shrink towards chunkSize as the work runs
+	/// out. Few scheduling steps for uniform items, balanced at the end.
+	Guided,
+	/// Every chunk is chunkSize items. For items whose cost varies a lot.
+	Dynamic
+};
+
+struct ChunkOptions
+{
+	Partitioning partitioning {Partitioning::Guided};
+	/// The smallest chunk for Guided, the size of every chunk for Dynamic. 0 picks one from the
+	/// number of items and hardware threads.
+	std::size_t chunkSize {0};
+};
+
+/// Emplace one task into `flow`, a tf::Taskflow or a tf::Subflow, that calls `callback(index)` for
+/// every index in [0, count), instead of one task per item.
+///
+/// Workers claim the items in chunks, so building the graph costs the same for any count and the
+/// scheduler is visited once per chunk rather than once per item. The callback may be called
+/// concurrently and in any order.
+template <typename FlowBuilder, typename Callback>
+tf::Task spawnChunked(
+	FlowBuilder& flow, std::size_t count, Callback&& callback, const ChunkOptions& options = {})
+{
+	std::size_t chunkSize = options.chunkSize;
+	if (chunkSize == 0)
+	{
+		// Guided chunks shrink on their own, a floor of one item loses little. Fixed chunks are
+		// sized for about eight per hardware thread.
+		const std::size_t numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		chunkSize = options.partitioning == Partitioning::Guided
+						? 1
+						: std::max<std::size_t>(count / (8 * numThreads), 1);
+	}
+
+	auto body = [callback = std::forward<Callback>(callback)](std::size_t index)
+	{ callback(index); };
+	if (options.partitioning == Partitioning::Guided)
+	{
+		return flow.for_each_index(
+			std::size_t {0}, count, std::size_t {1}, std::move(body),
+			tf::GuidedPartitioner(chunkSize));
+	}
+	return flow.for_each_index(
+		std::size_t {0}, count, std::size_t {1}, std::move(body),
+		tf::DynamicPartitioner(chunkSize));
+}
@@ -0,0 +1,432 @@
+#pragma once
+
+// Standard library includes.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+// Platform includes.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define COLLISION_HAS_X86_KERNELS 1
+#else
+#define COLLISION_HAS_X86_KERNELS 0
+#endif
+
+// Bodies, bounding boxes and pair lists of the collision detection in work_if_needed.cpp, stored
+// structure-of-arrays so that the loops over them touch only the fields they need and can be
+// vectorized.
+
+/// Spheres, element i of every array describes sphere i.
+struct Spheres
+{
+	std::vector<float> x, y, z;
+	std::vector<float> radius;
+
+	std::size_t size() const
+	{
+		return radius.size();
+	}
+
+	void resize(std::size_t n)
+	{
+		for (std::vector<float>* field : {&x, &y, &z, &radius})
+			field->resize(n);
+	}
+};
+
+/// Oriented boxes, element i of every array describes box i. A point p in the box's frame is at
+/// center + R p in the world, with R the row-major rotation rotation[0..8].
+struct Boxes
+{
+	std::vector<float> x, y, z;
+	std::vector<float> halfX, halfY, halfZ;
+	std::array<std::vector<float>, 9> rotation;
+
+	std::size_t size() const
+	{
+		return x.size();
+	}
+
+	void resize(std::size_t n)
+	{
+		for (std::vector<float>* field : {&x, &y, &z, &halfX, &halfY, &halfZ})
+			field->resize(n);
+		for (std::vector<float>& field : rotation)
+			field.resize(n);
+	}
+};
+
+/// Axis-aligned bounding boxes of all bodies, the spheres first and then the boxes, so body i is
+/// sphere i below the number of spheres and box i - numSpheres above.
+struct Aabbs
+{
+	// Indexed by axis, then body.
+	std::array<std::vector<float>, 3> min;
+	std::array<std::vector<float>, 3> max;
+
+	void resize(std::size_t n)
+	{
+		for (std::size_t axis = 0; axis < 3; ++axis)
+		{
+			min[axis].resize(n);
+			max[axis].resize(n);
+		}
+	}
+};
+
+/// A pair of bodies whose bounding boxes overlap. For sphere-box pairs a is the sphere and b the
+/// box, otherwise a < b. Indices are into Spheres and Boxes, not body numbers.
+struct Pair
+{
+	std::uint32_t a;
+	std::uint32_t b;
+};
+
+struct PairLists
+{
+	std::vector<Pair> sphereSphere;
+	std::vector<Pair> sphereBox;
+	std::vector<Pair> boxBox;
+
+	void clear()
+	{
+		sphereSphere.clear();
+		sphereBox.clear();
+		boxBox.clear();
+	}
+
+	std::size_t size() const
+	{
+		return sphereSphere.size() + sphereBox.size() + boxBox.size();
+	}
+
+	void append(const PairLists& other)
+	{
+		auto appendList = [](std::vector<Pair>& to, const std::vector<Pair>& from)
+		{ to.insert(to.end(), from.begin(), from.end()); };
+		appendList(sphereSphere, other.sphereSphere);
+		appendList(sphereBox, other.sphereBox);
+		appendList(boxBox, other.boxBox);
+	}
+};
+
+/// The kinds of pairs, in the order of the lists of PairLists and ContactLists.
+enum class PairType
+{
+	SphereSphere,
+	SphereBox,
+	BoxBox
+};
+
+constexpr std::size_t s_numPairTypes {3};
+
+/// The expected time per pair of each near-phase kernel, so that work can be split into chunks of
+/// equal time rather than equal pair counts. It starts from rough guesses and follows the
+/// measured times of the previous frames.
+struct NearPhaseCostModel
+{
+	/// Indexed by PairType.
+	std::array<double, s_numPairTypes> nanosecondsPerPair {10.0, 25.0, 100.0};
+	/// The weight of the newest measurement in the exponential moving average.
+	double smoothing {0.25};
+
+	double cost(PairType type) const
+	{
+		return nanosecondsPerPair[std::size_t(type)];
+	}
+
+	/// Fold in one frame's measurement, `seconds` spent on `numPairs` pairs of `type`.
+	void update(PairType type, double seconds, std::size_t numPairs)
+	{
+		if (numPairs == 0)
+			return;
+		const double measured = seconds * 1e9 / double(numPairs);
+		double& estimate = nanosecondsPerPair[std::size_t(type)];
+		estimate += smoothing * (measured - estimate);
+	}
+};
+
+/// Compute the bounding boxes of bodies [begin, end).
+inline void computeAabbs(
+	const Spheres& spheres, const Boxes& boxes, Aabbs& aabbs, std::size_t begin, std::size_t end)
+{
+	const std::size_t numSpheres = spheres.size();
+	const std::size_t sphereEnd = std::min(end, numSpheres);
+	for (std::size_t i = begin; i < sphereEnd; ++i)
+	{
+		const float center[3] {spheres.x[i], spheres.y[i], spheres.z[i]};
+		for (std::size_t axis = 0; axis < 3; ++axis)
+		{
+			aabbs.min[axis][i] = center[axis] - spheres.radius[i];
+			aabbs.max[axis][i] = center[axis] + spheres.radius[i];
+		}
+	}
+	for (std::size_t body = std::max(begin, numSpheres); body < end; ++body)
+	{
+		const std::size_t i = body - numSpheres;
+		const float center[3] {boxes.x[i], boxes.y[i], boxes.z[i]};
+		const float half[3] {boxes.halfX[i], boxes.halfY[i], boxes.halfZ[i]};
+		for (std::size_t axis = 0; axis < 3; ++axis)
+		{
+			// The extent along a world axis is the sum of the half extents projected onto it.
+			float extent {0.0f};
+			for (std::size_t j = 0; j < 3; ++j)
+				extent += std::abs(boxes.rotation[axis * 3 + j][i]) * half[j];
+			aabbs.min[axis][body] = center[axis] - extent;
+			aabbs.max[axis][body] = center[axis] + extent;
+		}
+	}
+}
+
+/// The axis along which the centers of the bounding boxes spread the most, the best one to sweep
+/// along since it separates the most bodies.
+inline std::size_t principalAxis(const Aabbs& aabbs)
+{
+	const std::size_t n = aabbs.min[0].size();
+	std::size_t best {0};
+	double bestVariance {-1.0};
+	for (std::size_t axis = 0; axis < 3; ++axis)
+	{
+		double sum {0.0};
+		double sumOfSquares {0.0};
+		for (std::size_t body = 0; body < n; ++body)
+		{
+			const double center = 0.5 * (double(aabbs.min[axis][body]) + aabbs.max[axis][body]);
+			sum += center;
+			sumOfSquares += center * center;
+		}
+		const double mean = n > 0 ? sum / double(n) : 0.0;
+		const double variance = n > 0 ? sumOfSquares / double(n) - mean * mean : 0.0;
+		if (variance > bestVariance)
+		{
+			bestVariance = variance;
+			best = axis;
+		}
+	}
+	return best;
+}
+
+/// Sweep and prune over the bodies in `order`, sorted by the lower bound of their bounding boxes
+/// along `axis`, for the bodies at positions [begin, end) of order. Every body is paired with the
+/// bodies after it in order whose lower bound is below its upper bound, if their bounding boxes
+/// also overlap along the other two axes, so ranges of positions can be swept independently.
+inline void sweepAndPrune(
+	const Aabbs& aabbs, const std::vector<std::uint32_t>& order, std::size_t axis,
+	std::size_t numSpheres, std::size_t begin, std::size_t end, PairLists& pairs)
+{
+	const std::size_t axis1 = (axis + 1) % 3;
+	const std::size_t axis2 = (axis + 2) % 3;
+	const std::vector<float>& sweepMin = aabbs.min[axis];
+	for (std::size_t p = begin; p < end; ++p)
+	{
+		const std::uint32_t first = order[p];
+		const float sweepMax = aabbs.max[axis][first];
+		for (std::size_t q = p + 1; q < order.size() && sweepMin[order[q]] <= sweepMax; ++q)
+		{
+			const std::uint32_t second = order[q];
+			if (aabbs.min[axis1][second] > aabbs.max[axis1][first] ||
+				aabbs.min[axis1][first] > aabbs.max[axis1][second] ||
+				aabbs.min[axis2][second] > aabbs.max[axis2][first] ||
+				aabbs.min[axis2][first] > aabbs.max[axis2][second])
+			{
+				continue;
+			}
+			const std::uint32_t a = std::min(first, second);
+			const std::uint32_t b = std::max(first, second);
+			const std::uint32_t firstBox = std::uint32_t(numSpheres);
+			if (b < firstBox)
+				pairs.sphereSphere.push_back({a, b});
+			else if (a < firstBox)
+				pairs.sphereBox.push_back({a, b - firstBox});
+			else
+				pairs.boxBox.push_back({a - firstBox, b - firstBox});
+		}
+	}
+}
+
+/// The contact of two touching bodies of a pair, a and b as in the pair. The normal is a unit
+/// vector pointing from a to b, depth is how far they overlap along it, and point is halfway
+/// through the overlap.
+struct Contact
+{
+	std::uint32_t a;
+	std::uint32_t b;
+	float normal[3];
+	float depth;
+	float point[3];
+};
+
+struct ContactLists
+{
+	std::vector<Contact> sphereSphere;
+	std::vector<Contact> sphereBox;
+	std::vector<Contact> boxBox;
+
+	/// Empty the lists but keep their capacity, so that a frame reuses the previous one's memory.
+	void clear()
+	{
+		sphereSphere.clear();
+		sphereBox.clear();
+		boxBox.clear();
+	}
+
+	std::size_t size() const
+	{
+		return sphereSphere.size() + sphereBox.size() + boxBox.size();
+	}
+
+	void append(const ContactLists& other)
+	{
+		auto appendList = [](std::vector<Contact>& to, const std::vector<Contact>& from)
+		{ to.insert(to.end(), from.begin(), from.end()); };
+		appendList(sphereSphere, other.sphereSphere);
+		appendList(sphereBox, other.sphereBox);
+		appendList(boxBox, other.boxBox);
+	}
+};
+
+// The near-phase kernels are written once in collision_kernels.h in terms of a vector type, and
+// compiled here once per instruction set with that type a vector of as many floats as a register
+// holds. The fields of the bodies of each batch of pairs are gathered into vector registers.
+
+namespace collision_scalar
+{
+using Float = float __attribute__((vector_size(4)));
+constexpr int s_width {1};
+
+inline Float splat(float x)
+{
+	return Float {x};
+}
+
+inline Float sqrtLanes(Float v)
+{
+	return Float {std::sqrt(v[0])};
+}
+
+inline Float gatherLanes(const float* base, const std::uint32_t* indices)
+{
+	return Float {base[indices[0]]};
+}
+
+#define COLLISION_TARGET
+#include "collision_kernels.h"
+#undef COLLISION_TARGET
+} // namespace collision_scalar
+
+#if COLLISION_HAS_X86_KERNELS
+
+namespace collision_avx2
+{
+using Float = float __attribute__((vector_size(32)));
+constexpr int s_width {8};
+
+__attribute__((target("avx2,fma"))) inline Float splat(float x)
+{
+	return Float(_mm256_set1_ps(x));
+}
+
+__attribute__((target("avx2,fma"))) inline Float sqrtLanes(Float v)
+{
+	return Float(_mm256_sqrt_ps(__m256(v)));
+}
+
+__attribute__((target("avx2,fma"))) inline Float gatherLanes(
+	const float* base, const std::uint32_t* indices)
+{
+	const __m256i offsets = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices));
+	return Float(_mm256_i32gather_ps(base, offsets, 4));
+}
+
+#define COLLISION_TARGET __attribute__((target("avx2,fma")))
+#include "collision_kernels.h"
+#undef COLLISION_TARGET
+} // namespace collision_avx2
+
+namespace collision_avx512
+{
+using Float = float __attribute__((vector_size(64)));
+constexpr int s_width {16};
+
+__attribute__((target("avx512f"))) inline Float splat(float x)
+{
+	return Float(_mm512_set1_ps(x));
+}
+
+__attribute__((target("avx512f"))) inline Float sqrtLanes(Float v)
+{
+	return Float(_mm512_sqrt_ps(__m512(v)));
+}
+
+__attribute__((target("avx512f"))) inline Float gatherLanes(
+	const float* base, const std::uint32_t* indices)
+{
+	const __m512i offsets = _mm512_loadu_si512(indices);
+	return Float(_mm512_i32gather_ps(offsets, base, 4));
+}
+
+#define COLLISION_TARGET __attribute__((target("avx512f")))
+#include "collision_kernels.h"
+#undef COLLISION_TARGET
+} // namespace collision_avx512
+
+#endif
+
+/// The near-phase kernels selected for the current CPU. Each computes the contacts of the
+/// touching pairs among numPairs pairs and appends them to the given list.
+struct CollisionKernels
+{
+	const char* name;
+	void (*sphereSphere)(
+		const Spheres& spheres, const Pair* pairs, std::size_t numPairs,
+		std::vector<Contact>& contacts);
+	void (*sphereBox)(
+		const Spheres& spheres, const Boxes& boxes, const Pair* pairs, std::size_t numPairs,
+		std::vector<Contact>& contacts);
+	void (*boxBox)(
+		const Boxes& boxes, const Pair* pairs, std::size_t numPairs,
+		std::vector<Contact>& contacts);
+};
+
+/// Pick the widest kernels the CPU supports. The COLLISION_KERNELS environment variable can be
+/// set to scalar, avx2, or avx512 to force a narrower version, for comparisons.
+inline CollisionKernels selectCollisionKernels()
+{
+	const CollisionKernels scalar {
+		"scalar", collision_scalar::sphereSphere, collision_scalar::sphereBox,
+		collision_scalar::boxBox};
+	const char* forced = std::getenv("COLLISION_KERNELS");
+	const std::string_view wanted = forced != nullptr ? forced : "avx512";
+	if (wanted == "scalar")
+		return scalar;
+#if COLLISION_HAS_X86_KERNELS
+	__builtin_cpu_init();
+	const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	const bool hasAvx512 = __builtin_cpu_supports("avx512f");
+	if (wanted == "avx512" && hasAvx512)
+	{
+		return {
+			"avx512", collision_avx512::sphereSphere, collision_avx512::sphereBox,
+			collision_avx512::boxBox};
+	}
+	if (hasAvx2)
+	{
+		return {
+			"avx2", collision_avx2::sphereSphere, collision_avx2::sphereBox,
+			collision_avx2::boxBox};
+	}
+#endif
+	return scalar;
+}
+
+inline const CollisionKernels& collisionKernels()
+{
+	static const CollisionKernels kernels = selectCollisionKernels();
+	return kernels;
+}
@@ -0,0 +1,334 @@
+// Near-phase kernels, written once for any vector width and included by collision.h once per
+// instruction set, inside a namespace that provides:
+//   Float                        A GCC vector extension type of s_width floats.
+//   s_width                      The number of lanes.
+//   COLLISION_TARGET             The target attribute the kernels are compiled with.
+//   splat(x)                     x in every lane.
+//   sqrtLanes(v)                 The square root of every lane.
+//   gatherLanes(base, indices)   base[indices[lane]] in every lane.
+// There is deliberately no include guard, and nothing is included here.
+//
+// Every kernel takes s_width pairs at a time, gathers the fields of their bodies into vectors,
+// computes the contact of every lane without branches, and appends the lanes that touch to
+// `contacts`. A partial last batch repeats its last pair in the unused lanes, which are then not
+// appended.
+
+using Mask = decltype(Float {} < Float {});
+
+COLLISION_TARGET inline Float absLanes(Float v)
+{
+	return v < splat(0.0f) ? -v : v;
+}
+
+COLLISION_TARGET inline Float minLanes(Float a, Float b)
+{
+	return a < b ? a : b;
+}
+
+COLLISION_TARGET inline Float maxLanes(Float a, Float b)
+{
+	return a < b ? b : a;
+}
+
+// -1 where v is negative, 1 elsewhere.
+COLLISION_TARGET inline Float signLanes(Float v)
+{
+	return v < splat(0.0f) ? splat(-1.0f) : splat(1.0f);
+}
+
+// The a and b of pairs [begin, begin + s_width), the last pair repeated past `count`.
+COLLISION_TARGET inline void loadPairs(
+	const Pair* pairs, std::size_t count, std::uint32_t* a, std::uint32_t* b)
+{
+	for (std::size_t lane = 0; lane < std::size_t(s_width); ++lane)
+	{
+		const Pair& pair = pairs[std::min(lane, count - 1)];
+		a[lane] = pair.a;
+		b[lane] = pair.b;
+	}
+}
+
+COLLISION_TARGET inline bool anyLane(Mask mask, std::size_t count)
+{
+	for (std::size_t lane = 0; lane < count; ++lane)
+	{
+		if (mask[lane] != 0)
+			return true;
+	}
+	return false;
+}
+
+COLLISION_TARGET inline void appendContacts(
+	std::vector<Contact>& contacts, Mask touching, std::size_t count, const std::uint32_t* a,
+	const std::uint32_t* b, const Float (&normal)[3], Float depth, const Float (&point)[3])
+{
+	for (std::size_t lane = 0; lane < count; ++lane)
+	{
+		if (touching[lane] == 0)
+			continue;
+		contacts.push_back(
+			{a[lane],
+			 b[lane],
+			 {normal[0][lane], normal[1][lane], normal[2][lane]},
+			 depth[lane],
+			 {point[0][lane], point[1][lane], point[2][lane]}});
+	}
+}
+
+COLLISION_TARGET inline void sphereSphere(
+	const Spheres& spheres, const Pair* pairs, std::size_t numPairs, std::vector<Contact>& contacts)
+{
+	std::uint32_t a[s_width];
+	std::uint32_t b[s_width];
+	for (std::size_t begin = 0; begin < numPairs; begin += s_width)
+	{
+		const std::size_t count = std::min<std::size_t>(s_width, numPairs - begin);
+		loadPairs(pairs + begin, count, a, b);
+		const Float centerA[3] {
+			gatherLanes(spheres.x.data(), a), gatherLanes(spheres.y.data(), a),
+			gatherLanes(spheres.z.data(), a)};
+		const Float centerB[3] {
+			gatherLanes(spheres.x.data(), b), gatherLanes(spheres.y.data(), b),
+			gatherLanes(spheres.z.data(), b)};
+		const Float radiusA = gatherLanes(spheres.radius.data(), a);
+		const Float radiusSum = radiusA + gatherLanes(spheres.radius.data(), b);
+
+		const Float delta[3] {
+			centerB[0] - centerA[0], centerB[1] - centerA[1], centerB[2] - centerA[2]};
+		const Float distanceSquared =
+			delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2];
+		const Mask touching = distanceSquared < radiusSum * radiusSum;
+		if (!anyLane(touching, count))
+			continue;
+
+		const Float distance = sqrtLanes(distanceSquared);
+		// Concentric spheres get an arbitrary normal.
+		const Mask apart = distance > splat(1e-6f);
+		const Float inverse = splat(1.0f) / (apart ? distance : splat(1.0f));
+		const Float normal[3] {
+			apart ? delta[0] * inverse : splat(1.0f), apart ? delta[1] * inverse : splat(0.0f),
+			apart ? delta[2] * inverse : splat(0.0f)};
+		const Float depth = radiusSum - distance;
+		// Halfway through the overlap.
+		const Float offset = radiusA - splat(0.5f) * depth;
+		const Float point[3] {
+			centerA[0] + normal[0] * offset, centerA[1] + normal[1] * offset,
+			centerA[2] + normal[2] * offset};
+		appendContacts(contacts, touching, count, a, b, normal, depth, point);
+	}
+}
+
+COLLISION_TARGET inline void sphereBox(
+	const Spheres& spheres, const Boxes& boxes, const Pair* pairs, std::size_t numPairs,
+	std::vector<Contact>& contacts)
+{
+	std::uint32_t a[s_width];
+	std::uint32_t b[s_width];
+	for (std::size_t begin = 0; begin < numPairs; begin += s_width)
+	{
+		const std::size_t count = std::min<std::size_t>(s_width, numPairs - begin);
+		loadPairs(pairs + begin, count, a, b);
+		const Float radius = gatherLanes(spheres.radius.data(), a);
+		const Float center[3] {
+			gatherLanes(boxes.x.data(), b), gatherLanes(boxes.y.data(), b),
+			gatherLanes(boxes.z.data(), b)};
+		const Float half[3] {
+			gatherLanes(boxes.halfX.data(), b), gatherLanes(boxes.halfY.data(), b),
+			gatherLanes(boxes.halfZ.data(), b)};
+		Float R[9];
+		for (int k = 0; k < 9; ++k)
+			R[k] = gatherLanes(boxes.rotation[k].data(), b);
+		const Float relative[3] {
+			gatherLanes(spheres.x.data(), a) - center[0],
+			gatherLanes(spheres.y.data(), a) - center[1],
+			gatherLanes(spheres.z.data(), a) - center[2]};
+
+		// The sphere's center in the box's frame, R^T relative, and the closest point of the box.
+		Float local[3];
+		Float closest[3];
+		Float outside[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			local[k] = R[k] * relative[0] + R[3 + k] * relative[1] + R[6 + k] * relative[2];
+			closest[k] = minLanes(maxLanes(local[k], -half[k]), half[k]);
+			outside[k] = local[k] - closest[k];
+		}
+		const Float distanceSquared =
+			outside[0] * outside[0] + outside[1] * outside[1] + outside[2] * outside[2];
+		const Mask inside = distanceSquared <= splat(0.0f);
+		const Mask touching = inside | (distanceSquared < radius * radius);
+		if (!anyLane(touching, count))
+			continue;
+
+		// Outside the box the normal points from the closest point to the center. Inside, it is the
+		// face normal of the face the center is closest to.
+		const Float distance = sqrtLanes(distanceSquared);
+		const Float inverse = splat(1.0f) / (inside ? splat(1.0f) : distance);
+		Float gap[3];
+		for (int k = 0; k < 3; ++k)
+			gap[k] = half[k] - absLanes(local[k]);
+		const Mask nearestX = inside & (gap[0] <= gap[1]) & (gap[0] <= gap[2]);
+		const Mask nearestY = inside & ~nearestX & (gap[1] <= gap[2]);
+		const Mask nearestZ = inside & ~nearestX & ~nearestY;
+		const Mask nearest[3] {nearestX, nearestY, nearestZ};
+		// In the box's frame, pointing out of the box.
+		Float outward[3];
+		Float pointLocal[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			const Float side = signLanes(local[k]);
+			outward[k] = inside ? (nearest[k] ? side : splat(0.0f)) : outside[k] * inverse;
+			pointLocal[k] = inside ? (nearest[k] ? side * half[k] : local[k]) : closest[k];
+		}
+		const Float depth =
+			inside ? radius + minLanes(minLanes(gap[0], gap[1]), gap[2]) : radius - distance;
+
+		// From the sphere into the box, so opposite to outward.
+		Float normal[3];
+		Float point[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			normal[k] = -(R[3 * k] * outward[0] + R[3 * k + 1] * outward[1] +
+						  R[3 * k + 2] * outward[2]);
+			point[k] = center[k] + R[3 * k] * pointLocal[0] + R[3 * k + 1] * pointLocal[1] +
+					   R[3 * k + 2] * pointLocal[2];
+		}
+		appendContacts(contacts, touching, count, a, b, normal, depth, point);
+	}
+}
+
+/// The state of a separating axis test of two oriented boxes, in the frame of box a.
+struct SeparatingAxes
+{
+	const Float (&t)[3];
+	const Float (&halfA)[3];
+	const Float (&halfB)[3];
+	const Float (&C)[3][3];
+	Mask separated = Float {} < Float {};
+	// The smallest overlap so far, squared and divided by the squared length of its axis so that
+	// axes of any length compare, and that axis, pointing from a to b.
+	Float best = splat(3.4e38f);
+	Float axis[3] {splat(1.0f), splat(0.0f), splat(0.0f)};
+	Float axisLengthSquared = splat(1.0f);
+
+	// Project both boxes onto the candidate axis, in the lanes where it is valid.
+	COLLISION_TARGET void test(const Float (&candidate)[3], Float lengthSquared, Mask valid)
+	{
+		const Float projection = t[0] * candidate[0] + t[1] * candidate[1] + t[2] * candidate[2];
+		Float radii {};
+		for (int k = 0; k < 3; ++k)
+		{
+			radii += halfA[k] * absLanes(candidate[k]);
+			const Float projectedAxis =
+				candidate[0] * C[0][k] + candidate[1] * C[1][k] + candidate[2] * C[2][k];
+			radii += halfB[k] * absLanes(projectedAxis);
+		}
+		const Float overlap = radii - absLanes(projection);
+		separated |= valid & (overlap < splat(0.0f));
+		const Float scaled = overlap * overlap / lengthSquared;
+		const Mask better = valid & (scaled < best);
+		const Float side = signLanes(projection);
+		best = better ? scaled : best;
+		axisLengthSquared = better ? lengthSquared : axisLengthSquared;
+		for (int k = 0; k < 3; ++k)
+			axis[k] = better ? candidate[k] * side : axis[k];
+	}
+};
+
+/// The separating axis test of two oriented boxes over the 15 candidate axes, the 3 face normals
+/// of each box and the 9 cross products of their edges, done in the frame of box a. The boxes
+/// touch if they overlap along every axis, and the contact normal is the axis of least overlap.
+COLLISION_TARGET inline void boxBox(
+	const Boxes& boxes, const Pair* pairs, std::size_t numPairs, std::vector<Contact>& contacts)
+{
+	std::uint32_t a[s_width];
+	std::uint32_t b[s_width];
+	for (std::size_t begin = 0; begin < numPairs; begin += s_width)
+	{
+		const std::size_t count = std::min<std::size_t>(s_width, numPairs - begin);
+		loadPairs(pairs + begin, count, a, b);
+		const Float centerA[3] {
+			gatherLanes(boxes.x.data(), a), gatherLanes(boxes.y.data(), a),
+			gatherLanes(boxes.z.data(), a)};
+		const Float halfA[3] {
+			gatherLanes(boxes.halfX.data(), a), gatherLanes(boxes.halfY.data(), a),
+			gatherLanes(boxes.halfZ.data(), a)};
+		const Float halfB[3] {
+			gatherLanes(boxes.halfX.data(), b), gatherLanes(boxes.halfY.data(), b),
+			gatherLanes(boxes.halfZ.data(), b)};
+		Float RA[9];
+		Float RB[9];
+		for (int k = 0; k < 9; ++k)
+		{
+			RA[k] = gatherLanes(boxes.rotation[k].data(), a);
+			RB[k] = gatherLanes(boxes.rotation[k].data(), b);
+		}
+		const Float delta[3] {
+			gatherLanes(boxes.x.data(), b) - centerA[0],
+			gatherLanes(boxes.y.data(), b) - centerA[1],
+			gatherLanes(boxes.z.data(), b) - centerA[2]};
+
+		// In a's frame: t, the center of b, and C, whose column j is axis j of b.
+		Float t[3];
+		Float C[3][3];
+		for (int i = 0; i < 3; ++i)
+		{
+			t[i] = RA[i] * delta[0] + RA[3 + i] * delta[1] + RA[6 + i] * delta[2];
+			for (int j = 0; j < 3; ++j)
+				C[i][j] = RA[i] * RB[j] + RA[3 + i] * RB[3 + j] + RA[6 + i] * RB[6 + j];
+		}
+
+		SeparatingAxes axes {t, halfA, halfB, C};
+		const Mask all = Float {} == Float {};
+		for (int i = 0; i < 3; ++i)
+		{
+			Float face[3] {splat(0.0f), splat(0.0f), splat(0.0f)};
+			face[i] = splat(1.0f);
+			axes.test(face, splat(1.0f), all);
+		}
+		for (int j = 0; j < 3; ++j)
+		{
+			const Float face[3] {C[0][j], C[1][j], C[2][j]};
+			axes.test(face, splat(1.0f), all);
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				// e_i x column j of C. Near-parallel edges give no axis, the face axes cover them.
+				const Float* column[3] {&C[0][j], &C[1][j], &C[2][j]};
+				Float edge[3];
+				edge[i] = splat(0.0f);
+				edge[(i + 1) % 3] = -*column[(i + 2) % 3];
+				edge[(i + 2) % 3] = *column[(i + 1) % 3];
+				const Float lengthSquared =
+					edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+				axes.test(edge, lengthSquared, lengthSquared > splat(1e-6f));
+			}
+		}
+		const Mask touching = ~axes.separated;
+		if (!anyLane(touching, count))
+			continue;
+
+		const Float inverseLength = splat(1.0f) / sqrtLanes(axes.axisLengthSquared);
+		const Float depth = sqrtLanes(axes.best);
+		Float normalA[3];
+		Float extentA {};
+		for (int k = 0; k < 3; ++k)
+		{
+			normalA[k] = axes.axis[k] * inverseLength;
+			extentA += halfA[k] * absLanes(normalA[k]);
+		}
+		// Halfway through the overlap, on the line through a's center along the normal.
+		const Float offset = extentA - splat(0.5f) * depth;
+		Float normal[3];
+		Float point[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			normal[k] = RA[3 * k] * normalA[0] + RA[3 * k + 1] * normalA[1] +
+						RA[3 * k + 2] * normalA[2];
+			point[k] = centerA[k] + normal[k] * offset;
+		}
+		appendContacts(contacts, touching, count, a, b, normal, depth, point);
+	}
+}
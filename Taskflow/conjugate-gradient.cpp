@@ -0,0 +1,104 @@
+// Project includes
+#include "conjugate_gradient.h"
+#include "gauss_seidel.h"
+#include "sparse.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Solves the same symmetric positive definite system with Gauss-Seidel and with conjugate
+// gradient without preconditioning, with a Jacobi preconditioner and with a symmetric Gauss-Seidel
+// preconditioner, and compares iteration counts and wall time. The smaller the diagonal shift the
+// worse A is conditioned, see randomSymmetricStencilMatrix, and the further Gauss-Seidel falls
+// behind.
+//
+// Usage:
+//   conjugate-gradient [num unknowns] [diagonal shift] [max iterations]
+
+struct Result
+{
+	std::string method;
+	int iterations;
+	double residual_norm;
+	double seconds;
+};
+
+template <typename Solver>
+Result run(tf::Executor& executor, const typename Solver::Options& options, std::string method)
+{
+	Solver solver(options);
+	const auto start = std::chrono::steady_clock::now();
+	executor.run(solver.taskflow()).wait();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return {std::move(method), solver.numIterations(), solver.residualNorm(), elapsed.count()};
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t n {100'000};
+	double diagonal_shift {1e-2};
+	int max_iterations {1000};
+	if (argc > 1)
+		n = std::stoul(argv[1]);
+	if (argc > 2)
+		diagonal_shift = std::stod(argv[2]);
+	if (argc > 3)
+		max_iterations = std::stoi(argv[3]);
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> dist(0.0, 1.0);
+	const CsrMatrix A =
+		randomSymmetricStencilMatrix(n, diagonal_shift, [&rng, &dist]() { return dist(rng); });
+	std::vector<double> b(n);
+	for (double& value : b)
+		value = dist(rng);
+
+	tf::Executor executor;
+	std::vector<Result> results;
+
+	GaussSeidel::Options gauss_seidel;
+	gauss_seidel.name = "Gauss-Seidel";
+	gauss_seidel.matrix = &A;
+	gauss_seidel.rightHandSide = GaussSeidel::RightHandSide::Values;
+	gauss_seidel.rightHandSideValues = b;
+	gauss_seidel.maxIterations = max_iterations;
+	gauss_seidel.trajectory.capacity = 1;
+	gauss_seidel.printReport = false;
+	results.push_back(run<GaussSeidel>(executor, gauss_seidel, "Gauss-Seidel"));
+
+	for (ConjugateGradient::Preconditioner preconditioner :
+		 {ConjugateGradient::Preconditioner::None, ConjugateGradient::Preconditioner::Jacobi,
+		  ConjugateGradient::Preconditioner::SymmetricGaussSeidel})
+	{
+		ConjugateGradient::Options options;
+		options.matrix = &A;
+		options.rightHandSideValues = b;
+		options.maxIterations = max_iterations;
+		options.preconditioner = preconditioner;
+		options.printReport = false;
+		results.push_back(run<ConjugateGradient>(
+			executor, options,
+			std::string("CG, ") + ConjugateGradient::preconditionerName(preconditioner)));
+	}
+
+	std::cout << "Unknowns: " << n << ", diagonal shift: " << diagonal_shift << ", "
+			  << executor.num_workers() << " workers\n";
+	std::cout << std::left << std::setw(28) << "Method" << std::right << std::setw(12)
+			  << "Iterations" << std::setw(14) << "Residual" << std::setw(12) << "Time (s)" << '\n';
+	for (const Result& result : results)
+	{
+		std::cout << std::left << std::setw(28) << result.method << std::right << std::setw(12)
+				  << result.iterations << std::setw(14) << std::scientific << std::setprecision(3)
+				  << result.residual_norm << std::setw(12) << std::fixed << std::setprecision(4)
+				  << result.seconds << '\n';
+	}
+}
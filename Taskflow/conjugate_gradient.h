@@ -0,0 +1,478 @@
+#pragma once
+
+// Project includes
+#include "sparse.h"
+#include "utils.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+#include "taskflow/algorithm/for_each.hpp"
+#include "taskflow/algorithm/reduce.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <ios>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// A preconditioned conjugate gradient solve of Ax = b, for symmetric positive definite A.
+///
+/// The task graph has the same shape as GaussSeidel's, Init A -> Color A, Init x and Read b ->
+/// Compute Residual -> Should loop -> Update x -> Compute Residual, so the two can be compared
+/// directly. Update x runs one CG step, built by Color A as a graph of parallel loops with the
+/// two dot products done by tf::transform_reduce over chunks of rows:
+///
+///   z = M^-1 r -> rho = r.z -> p = z + beta p -> q = Ap -> p.q -> x += alpha p, r -= alpha q
+///
+/// Compute Residual computes r = b - Ax on the first iteration and only the norm of the updated r
+/// after that.
+///
+/// The symmetric Gauss-Seidel preconditioner is a forward sweep over the colors of A from z = 0,
+/// followed by a backward sweep, each color in parallel. That needs the sparsity pattern of A to
+/// be structurally symmetric, as it is for a symmetric A.
+///
+/// An instance may not be moved since the tasks refer back to it.
+class ConjugateGradient
+{
+public:
+	enum class Preconditioner
+	{
+		None,
+		Jacobi,
+		SymmetricGaussSeidel,
+	};
+
+	struct Options
+	{
+		std::string name {"Conjugate Gradient"};
+		// Ignored when matrix is set.
+		std::size_t numUnknowns {2};
+		// Use this A instead of a random one, see randomSymmetricStencilMatrix.
+		const CsrMatrix* matrix {nullptr};
+		// Random if empty.
+		std::vector<double> rightHandSideValues {};
+		int maxIterations {16};
+		double tolerance {1e-6};
+		Preconditioner preconditioner {Preconditioner::Jacobi};
+		// Zero means a random seed.
+		unsigned seed {0};
+		// Whether Print result writes the report to stdout.
+		bool printReport {true};
+	};
+
+	explicit ConjugateGradient(const Options& options);
+	ConjugateGradient(const ConjugateGradient&) = delete;
+	ConjugateGradient& operator=(const ConjugateGradient&) = delete;
+
+	/// The solver's task graph, run it with tf::Executor::run or embed it with composed_of.
+	tf::Taskflow& taskflow();
+
+	// Task callbacks.
+	void initA();
+	void colorA();
+	void initX();
+	void readB();
+	void computeResidual(tf::Subflow& subflow);
+	int shouldLoop();
+	int updateX(tf::Runtime& runtime);
+	void printResult();
+
+	// Results.
+	const std::string& name() const;
+	int numIterations() const;
+	double residualNorm() const;
+	bool converged() const;
+	const std::vector<double>& x() const;
+
+	/// Write the solution report printed by the Print result task.
+	void writeReport(std::ostream& stream);
+
+	static const char* preconditionerName(Preconditioner preconditioner);
+
+private:
+	double nextDouble();
+	bool done() const;
+	void emplacePrecondition(tf::Task start, tf::Task rho);
+
+	// Rows of [begin, end) of the chunk starting at begin.
+	std::size_t chunkEnd(std::size_t begin) const;
+	double dotChunk(const std::vector<double>& u, const std::vector<double>& v, std::size_t chunk)
+		const;
+
+private:
+	// Vectors are updated and reduced in chunks of this many rows.
+	static constexpr std::size_t s_chunkSize {4096};
+
+	// The diagonal shift of a generated A, see randomSymmetricStencilMatrix.
+	static constexpr double s_generatedDiagonalShift {1e-2};
+
+	Options m_options;
+	std::mt19937 m_rng;
+
+	CsrMatrix m_A;
+	RowColoring m_coloring;
+	std::vector<double> m_inverseDiagonal;
+
+	std::vector<double> m_x;
+	std::vector<double> m_b;
+	std::vector<double> m_r;
+	std::vector<double> m_z;
+	std::vector<double> m_p;
+	std::vector<double> m_q;
+	std::vector<double> m_rChunkSums;
+
+	// 0, 1, ..., number of chunks - 1, the range reduced over by the dot products.
+	std::vector<std::size_t> m_chunks;
+
+	double m_rho {0.0};
+	double m_previousRho {0.0};
+	double m_pq {0.0};
+
+	// One CG step. Built by colorA and run by updateX.
+	tf::Taskflow m_step;
+
+	int m_numIterations {0};
+
+	tf::Taskflow m_taskflow;
+};
+
+inline ConjugateGradient::ConjugateGradient(const Options& options)
+	: m_options(options)
+	, m_rng(options.seed != 0 ? options.seed : std::random_device {}())
+{
+	tf::Task initA = m_taskflow.emplace([this]() { this->initA(); });
+	tf::Task colorA = m_taskflow.emplace([this]() { this->colorA(); });
+	tf::Task initX = m_taskflow.emplace([this]() { this->initX(); });
+	tf::Task readB = m_taskflow.emplace([this]() { this->readB(); });
+	tf::Task computeResidual =
+		m_taskflow.emplace([this](tf::Subflow& subflow) { this->computeResidual(subflow); });
+	tf::Task shouldLoop = m_taskflow.emplace([this]() { return this->shouldLoop(); });
+	tf::Task updateX =
+		m_taskflow.emplace([this](tf::Runtime& runtime) { return this->updateX(runtime); });
+	tf::Task printResult = m_taskflow.emplace([this]() { this->printResult(); });
+
+	// Init x and Read b size everything after A, which may be given.
+	initA.precede(colorA, initX, readB);
+	computeResidual.succeed(colorA, initX, readB);
+	computeResidual.precede(shouldLoop);
+	shouldLoop.precede(updateX, printResult);
+	updateX.precede(computeResidual);
+
+	m_taskflow.name(m_options.name);
+	initA.name("Init A");
+	colorA.name("Color A");
+	initX.name("Init x");
+	readB.name("Read b");
+	computeResidual.name("Compute Residual");
+	shouldLoop.name("Should loop");
+	updateX.name("Update x");
+	printResult.name("Print result");
+}
+
+inline tf::Taskflow& ConjugateGradient::taskflow()
+{
+	return m_taskflow;
+}
+
+inline const char* ConjugateGradient::preconditionerName(Preconditioner preconditioner)
+{
+	switch (preconditioner)
+	{
+		case Preconditioner::None:
+			return "none";
+		case Preconditioner::Jacobi:
+			return "Jacobi";
+		case Preconditioner::SymmetricGaussSeidel:
+			return "symmetric Gauss-Seidel";
+	}
+	return "";
+}
+
+inline double ConjugateGradient::nextDouble()
+{
+	std::uniform_real_distribution<double> dist(0.0, 1.0);
+	return dist(m_rng);
+}
+
+inline std::size_t ConjugateGradient::chunkEnd(std::size_t begin) const
+{
+	return std::min(begin + s_chunkSize, m_A.numRows);
+}
+
+inline double ConjugateGradient::dotChunk(
+	const std::vector<double>& u, const std::vector<double>& v, std::size_t chunk) const
+{
+	const std::size_t begin = chunk * s_chunkSize;
+	const std::size_t end = chunkEnd(begin);
+	double sum {0.0};
+	for (std::size_t i = begin; i < end; ++i)
+		sum += u[i] * v[i];
+	return sum;
+}
+
+inline void ConjugateGradient::initA()
+{
+	if (m_options.matrix != nullptr)
+	{
+		m_A = *m_options.matrix;
+		return;
+	}
+	m_A = randomSymmetricStencilMatrix(
+		m_options.numUnknowns, s_generatedDiagonalShift, [this]() { return nextDouble(); });
+}
+
+inline void ConjugateGradient::colorA()
+{
+	const std::size_t n = m_A.numRows;
+	if (m_options.preconditioner == Preconditioner::SymmetricGaussSeidel)
+		m_coloring = colorRows(m_A);
+	m_inverseDiagonal.resize(n);
+	for (std::size_t row = 0; row < n; ++row)
+		m_inverseDiagonal[row] = 1.0 / m_A.diagonal(row);
+	m_chunks.resize((n + s_chunkSize - 1) / s_chunkSize);
+	std::iota(m_chunks.begin(), m_chunks.end(), std::size_t {0});
+
+	m_step.clear();
+	auto forEachChunk = [this, n](auto&& body)
+	{
+		return m_step.for_each_index(
+			std::size_t {0}, n, s_chunkSize,
+			[this, body](std::size_t begin) { body(begin, chunkEnd(begin)); });
+	};
+
+	// The reductions add to their result, so clear them up front.
+	tf::Task start = m_step.emplace(
+		[this]()
+		{
+			m_previousRho = m_rho;
+			m_rho = 0.0;
+			m_pq = 0.0;
+		});
+	tf::Task rho = m_step.transform_reduce(
+		m_chunks.begin(), m_chunks.end(), m_rho, std::plus<double>(),
+		[this](std::size_t chunk) { return dotChunk(m_r, m_z, chunk); });
+	tf::Task updateP = forEachChunk(
+		[this](std::size_t begin, std::size_t end)
+		{
+			const double beta = m_numIterations == 0 ? 0.0 : m_rho / m_previousRho;
+			for (std::size_t i = begin; i < end; ++i)
+				m_p[i] = m_z[i] + beta * m_p[i];
+		});
+	tf::Task computeQ = forEachChunk(
+		[this](std::size_t begin, std::size_t end)
+		{ multiplyRows(m_A, m_p.data(), m_q.data(), begin, end); });
+	tf::Task pq = m_step.transform_reduce(
+		m_chunks.begin(), m_chunks.end(), m_pq, std::plus<double>(),
+		[this](std::size_t chunk) { return dotChunk(m_p, m_q, chunk); });
+	tf::Task updateXR = forEachChunk(
+		[this](std::size_t begin, std::size_t end)
+		{
+			// Zero only once the residual is exactly zero, which Should loop catches first.
+			const double alpha = m_pq != 0.0 ? m_rho / m_pq : 0.0;
+			for (std::size_t i = begin; i < end; ++i)
+			{
+				m_x[i] += alpha * m_p[i];
+				m_r[i] -= alpha * m_q[i];
+			}
+		});
+
+	emplacePrecondition(start, rho);
+	rho.precede(updateP);
+	updateP.precede(computeQ);
+	computeQ.precede(pq);
+	pq.precede(updateXR);
+
+	start.name("Start step");
+	rho.name("r.z");
+	updateP.name("Update p");
+	computeQ.name("q = Ap");
+	pq.name("p.q");
+	updateXR.name("Update x and r");
+}
+
+// The tasks that compute z = M^-1 r, between Start step and rho = r.z.
+inline void ConjugateGradient::emplacePrecondition(tf::Task start, tf::Task rho)
+{
+	const std::size_t n = m_A.numRows;
+	switch (m_options.preconditioner)
+	{
+		case Preconditioner::None:
+		case Preconditioner::Jacobi:
+		{
+			const bool jacobi = m_options.preconditioner == Preconditioner::Jacobi;
+			tf::Task precondition = m_step.for_each_index(
+				std::size_t {0}, n, s_chunkSize,
+				[this, jacobi](std::size_t begin)
+				{
+					const std::size_t end = chunkEnd(begin);
+					for (std::size_t i = begin; i < end; ++i)
+						m_z[i] = jacobi ? m_r[i] * m_inverseDiagonal[i] : m_r[i];
+				});
+			precondition.name(jacobi ? "z = D^-1 r" : "z = r");
+			precondition.precede(rho);
+			break;
+		}
+		case Preconditioner::SymmetricGaussSeidel:
+		{
+			tf::Task previous = m_step.for_each_index(
+				std::size_t {0}, n, s_chunkSize,
+				[this](std::size_t begin)
+				{ std::fill(m_z.begin() + begin, m_z.begin() + chunkEnd(begin), 0.0); });
+			previous.name("z = 0");
+			const std::size_t numColors = m_coloring.numColors();
+			for (std::size_t sweep = 0; sweep < 2 * numColors; ++sweep)
+			{
+				const std::size_t color = sweep < numColors ? sweep : 2 * numColors - 1 - sweep;
+				tf::Task updateColor = m_step.for_each_index(
+					m_coloring.colorBegin[color], m_coloring.colorBegin[color + 1], std::size_t {1},
+					[this](std::size_t i)
+					{ gaussSeidelRow(m_A, m_z.data(), m_r.data(), m_coloring.rows[i]); });
+				updateColor.name(
+					(sweep < numColors ? "Forward color " : "Backward color ") +
+					std::to_string(color));
+				previous.precede(updateColor);
+				previous = updateColor;
+			}
+			previous.precede(rho);
+			break;
+		}
+	}
+	start.precede(rho);
+}
+
+inline void ConjugateGradient::initX()
+{
+	const std::size_t n = m_A.numRows;
+	m_x.assign(n, 0.0);
+	m_r.assign(n, 0.0);
+	m_z.assign(n, 0.0);
+	m_p.assign(n, 0.0);
+	m_q.assign(n, 0.0);
+	m_rChunkSums.assign((n + s_chunkSize - 1) / s_chunkSize, 0.0);
+	m_rho = 0.0;
+	m_numIterations = 0;
+}
+
+inline void ConjugateGradient::readB()
+{
+	const std::size_t n = m_A.numRows;
+	if (!m_options.rightHandSideValues.empty())
+	{
+		m_b = m_options.rightHandSideValues;
+		m_b.resize(n, 0.0);
+		return;
+	}
+	// The same b as GaussSeidel's RightHandSide::Random for the same seed.
+	std::mt19937 rng(m_options.seed != 0 ? m_options.seed + 1 : std::random_device {}());
+	std::uniform_real_distribution<double> dist(0.0, 1.0);
+	m_b.resize(n);
+	for (double& value : m_b)
+		value = dist(rng);
+}
+
+inline void ConjugateGradient::computeResidual(tf::Subflow& subflow)
+{
+	const std::size_t n = m_A.numRows;
+	subflow.for_each_index(
+		std::size_t {0}, n, s_chunkSize,
+		[this](std::size_t begin)
+		{
+			const std::size_t end = chunkEnd(begin);
+			double& sum = m_rChunkSums[begin / s_chunkSize];
+			if (m_numIterations > 0)
+			{
+				sum = sparseKernels().sumOfSquares(m_r.data() + begin, end - begin);
+				return;
+			}
+			// The kernels compute Ax - b, CG wants b - Ax.
+			sum = computeResidualRows(m_A, m_x.data(), m_b.data(), m_r.data(), begin, end);
+			for (std::size_t i = begin; i < end; ++i)
+				m_r[i] = -m_r[i];
+		});
+}
+
+inline bool ConjugateGradient::done() const
+{
+	return m_numIterations >= m_options.maxIterations || converged();
+}
+
+inline int ConjugateGradient::shouldLoop()
+{
+	constexpr int loopAgain {0};
+	constexpr int exitLoop {1};
+	if (done())
+	{
+		return exitLoop;
+	}
+	else
+	{
+		return loopAgain;
+	}
+}
+
+// A condition task so that the edge back up to Compute Residual is a weak dependency, as in
+// GaussSeidel::updateX.
+inline int ConjugateGradient::updateX(tf::Runtime& runtime)
+{
+	runtime.corun(m_step);
+	++m_numIterations;
+	return 0;
+}
+
+inline void ConjugateGradient::printResult()
+{
+	if (!m_options.printReport)
+		return;
+	// Built up front so that concurrent solvers don't interleave their reports.
+	std::ostringstream report;
+	writeReport(report);
+	bufferedCout() << report.str();
+}
+
+inline const std::string& ConjugateGradient::name() const
+{
+	return m_options.name;
+}
+
+inline int ConjugateGradient::numIterations() const
+{
+	return m_numIterations;
+}
+
+inline double ConjugateGradient::residualNorm() const
+{
+	return std::sqrt(std::accumulate(m_rChunkSums.begin(), m_rChunkSums.end(), 0.0));
+}
+
+inline bool ConjugateGradient::converged() const
+{
+	return residualNorm() < m_options.tolerance;
+}
+
+inline const std::vector<double>& ConjugateGradient::x() const
+{
+	return m_x;
+}
+
+inline void ConjugateGradient::writeReport(std::ostream& stream)
+{
+	stream << '\n';
+	stream << m_options.name << ":\n";
+	stream << "Unknowns: " << m_A.numRows << '\n';
+	stream << "Non-zeros: " << m_A.numNonZeros() << '\n';
+	stream << "Preconditioner: " << preconditionerName(m_options.preconditioner) << '\n';
+	if (m_options.preconditioner == Preconditioner::SymmetricGaussSeidel)
+		stream << "Colors: " << m_coloring.numColors() << '\n';
+	stream << "Residual norm: " << std::scientific << std::setprecision(4) << residualNorm()
+		   << '\n';
+	stream << "Iterations: " << m_numIterations << '\n';
+}
@@ -127,7 +127,10 @@ int main()
 	input.precede(dynamic);
 	executor.run(taskflow).wait();
 
-	dumpToFile(taskflow, "dynamic_task.dot");
+	const GraphAnalysis analysis = analyzeTaskflow(taskflow);
+	printAnalysis(analysis);
+	exportGraph(taskflow, "dynamic_task.dot");
+	clearAndReport(taskflow, analysis.numTasks);
 
 	return 0;
 }
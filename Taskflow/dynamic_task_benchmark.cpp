@@ -0,0 +1,103 @@
+// Project includes
+#include "bulk_spawn.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Compares fanning out N work items from a subflow with one task per item, as
+// create_dynamic_tasks in dynamic_task.cpp does, against spawnChunked with guided and with dynamic
+// partitioning. The time includes building the subflow, which is what grows with N for one task
+// per item.
+//
+// Every item runs `work` iterations of a square root, so the cost of an item can be varied from
+// far below the cost of a task to far above it.
+//
+// Usage:
+//   dynamic_task_benchmark [max items] [work]
+
+constexpr int num_repetitions {3};
+int work {16};
+std::vector<double> values;
+
+void work_item(std::size_t index)
+{
+	double value = double(index);
+	for (int i = 0; i < work; ++i)
+		value = std::sqrt(value + 1.0);
+	values[index] = value;
+}
+
+void one_task_per_item(tf::Subflow& subflow, std::size_t count)
+{
+	for (std::size_t index = 0; index < count; ++index)
+		subflow.emplace([index]() { work_item(index); });
+}
+
+double time_fan_out(
+	tf::Executor& executor, std::size_t count,
+	const std::function<void(tf::Subflow&, std::size_t)>& fan_out)
+{
+	tf::Taskflow taskflow;
+	taskflow.emplace([count, &fan_out](tf::Subflow& subflow) { fan_out(subflow, count); });
+	double best {std::numeric_limits<double>::max()};
+	for (int repetition = 0; repetition < num_repetitions; ++repetition)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		executor.run(taskflow).wait();
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t max_count {1'000'000};
+	if (argc > 1)
+		max_count = std::stoul(argv[1]);
+	if (argc > 2)
+		work = std::stoi(argv[2]);
+
+	const std::vector<std::pair<std::string, std::function<void(tf::Subflow&, std::size_t)>>>
+		variants {
+			{"Per item", one_task_per_item},
+			{"Guided",
+			 [](tf::Subflow& subflow, std::size_t count)
+			 { spawnChunked(subflow, count, work_item, {Partitioning::Guided, 0}); }},
+			{"Dynamic",
+			 [](tf::Subflow& subflow, std::size_t count)
+			 { spawnChunked(subflow, count, work_item, {Partitioning::Dynamic, 0}); }},
+		};
+
+	tf::Executor executor;
+	std::cout << "Million items per second, " << executor.num_workers() << " workers, " << work
+			  << " square roots per item.\n";
+	std::cout << std::setw(10) << "Items";
+	for (const auto& [name, fan_out] : variants)
+		std::cout << std::setw(12) << name;
+	std::cout << '\n';
+
+	for (std::size_t count = 1000; count <= max_count; count *= 10)
+	{
+		values.assign(count, 0.0);
+		std::cout << std::setw(10) << count << std::fixed << std::setprecision(2);
+		for (const auto& [name, fan_out] : variants)
+		{
+			const double seconds = time_fan_out(executor, count, fan_out);
+			std::cout << std::setw(12) << double(count) / seconds / 1e6;
+		}
+		std::cout << '\n';
+	}
+}
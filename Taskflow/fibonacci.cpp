@@ -1,36 +1,108 @@
 #include "utils.h"
 #include "taskflow/taskflow.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <taskflow/core/executor.hpp>
 
+// Below this n the recursion runs inline in the calling task, spawning tasks there would cost
+// more than the work they do.
+int cutoff {2};
+
+// Name the tasks, log every spawn and keep the subflows so that the graph can be dumped and
+// analyzed afterwards. Off unless asked for since it allocates for every task.
+bool describe_tasks {false};
+
+int fib_serial(int n)
+{
+	return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
 int spawn(int n, tf::Subflow& subflow)
 {
-	subflow.retain(true);
-	if (n < 2)
-		return n;
+	if (n < std::max(cutoff, 2))
+		return fib_serial(n);
+	subflow.retain(describe_tasks);
 	int result1, result2;
 	tf::Task task1 = subflow.emplace([n, &result1](tf::Subflow& subsubflow) { result1 = spawn(n - 1, subsubflow); });
 	tf::Task task2 = subflow.emplace([n, &result2](tf::Subflow& subsubflow) { result2 = spawn(n - 2, subsubflow); });
-	subflow.join(); // Join to run the subflow immediately.
-	task1.name("fib(" + std::to_string(n - 1) + ")=" + std::to_string(result1));
-	task2.name("fib(" + std::to_string(n - 2) + ")=" + std::to_string(result2));
-	lockedCout() << "spawn(" << n << ") returning " << result1 << " + " << result2 << " = " << (result1 + result2) << '\n';
+	if (describe_tasks)
+	{
+		// Named before they run so that traces show them.
+		task1.name("fib(" + std::to_string(n - 1) + ")");
+		task2.name("fib(" + std::to_string(n - 2) + ")");
+	}
+	// Join to run the subflow immediately. Time blocked in the join isn't this task's own work.
+	TaskDurationObserver::join(subflow);
+	if (describe_tasks)
+	{
+		task1.name(task1.name() + "=" + std::to_string(result1));
+		task2.name(task2.name() + "=" + std::to_string(result2));
+		bufferedCout() << "spawn(" << n << ") returning " << result1 << " + " << result2 << " = " << (result1 + result2) << '\n';
+	}
 	return result1 + result2;
 }
 
-int main()
+// Usage:
+//   fibonacci [-d] [n] [cutoff]
+//
+// The default cutoff spawns tasks all the way down, to show the graph. For large n a cutoff around
+// 20 leaves enough tasks to spread over the workers while each runs at serial speed.
+//
+// -d names the tasks, logs every spawn, prints an analysis of the graph and dumps it to
+// fibonacci.dot. Set TASK_TRACE to a file name to write a Chrome trace of the run there, which
+// also names the tasks.
+int main(int argc, char** argv)
 {
+	int n {5};
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg == "-d")
+			describe_tasks = true;
+		else
+			positional.emplace_back(arg);
+	}
+	if (positional.size() > 0)
+		n = std::stoi(positional[0]);
+	if (positional.size() > 1)
+		cutoff = std::stoi(positional[1]);
+	const char* trace = std::getenv("TASK_TRACE");
+	if (trace != nullptr && *trace != '\0')
+		describe_tasks = true;
+
 	tf::Executor executor;
+	traceIfRequested(executor);
+	std::shared_ptr<TaskDurationObserver> durations;
+	if (describe_tasks)
+		durations = executor.make_observer<TaskDurationObserver>();
 	tf::Taskflow taskflow;
 
-	int n {5};
 	int result {0};
 	tf::Task task = taskflow.emplace([n, &result](tf::Subflow& subflow) { result = spawn(n, subflow); });
+	if (describe_tasks)
+		task.name("fib(" + std::to_string(n) + ")");
+	const auto start = std::chrono::steady_clock::now();
 	executor.run(taskflow).wait();
-	task.name("fib(" + std::to_string(n) + ")=" + std::to_string(result));
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	flushLog();
 	std::cout << "fib(" << n << ") = " << result << '\n';
+	std::cout << "Time: " << elapsed.count() << " s with " << executor.num_workers()
+			  << " workers, cutoff " << cutoff << '\n';
 
-	taskflow.name("Fibonacci");
-	dumpToFile(taskflow, "fibonacci.dot");
+	if (describe_tasks)
+	{
+		task.name(task.name() + "=" + std::to_string(result));
+		const GraphAnalysis analysis = analyzeTaskflow(taskflow, durations.get());
+		printAnalysis(analysis);
+		taskflow.name("Fibonacci");
+		exportGraph(taskflow, "fibonacci.dot");
+		clearAndReport(taskflow, analysis.numTasks);
+	}
 }
@@ -0,0 +1,210 @@
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compares fork-join primitives on recursive Fibonacci, for a range of n and worker counts:
+//   Subflow:    A subflow task per call, joined explicitly, as in fibonacci.cpp.
+//   Async:      tf::Executor::silent_async for fib(n - 1), fib(n - 2) computed inline, and
+//               tf::Executor::corun_until to wait, which keeps the worker running other tasks.
+//   std::async: std::launch::async for fib(n - 1), a thread per call, blocking in get().
+//   Serial:     Plain recursion, the baseline for speedup.
+// Below the cutoff, which is at least 2, every variant recurses serially. std::async is skipped
+// for n with more than max_std_async_tasks tasks, since every task holds an OS thread until its
+// children are done and there are limits to how many threads a process may have.
+//
+// A task is one call at or above the cutoff, every variant forks once per such call. Speedup is
+// against Serial for the same n. Peak RSS is the high water mark of resident memory during the
+// run, reset before it, where /proc allows that.
+//
+// Usage:
+//   fibonacci_benchmark [max n] [cutoff]
+
+constexpr int num_repetitions {3};
+constexpr double max_std_async_tasks {2000.0};
+int cutoff {12};
+
+long fib_serial(int n)
+{
+	return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+long fib_subflow(int n, tf::Subflow& subflow)
+{
+	if (n < cutoff)
+		return fib_serial(n);
+	long result1, result2;
+	subflow.emplace([n, &result1](tf::Subflow& child) { result1 = fib_subflow(n - 1, child); });
+	subflow.emplace([n, &result2](tf::Subflow& child) { result2 = fib_subflow(n - 2, child); });
+	subflow.join();
+	return result1 + result2;
+}
+
+long fib_async(int n, tf::Executor& executor)
+{
+	if (n < cutoff)
+		return fib_serial(n);
+	long result1 {0};
+	std::atomic<bool> done {false};
+	executor.silent_async(
+		[n, &executor, &result1, &done]()
+		{
+			result1 = fib_async(n - 1, executor);
+			done.store(true, std::memory_order_release);
+		});
+	const long result2 = fib_async(n - 2, executor);
+	executor.corun_until([&done]() { return done.load(std::memory_order_acquire); });
+	return result1 + result2;
+}
+
+long fib_std_async(int n)
+{
+	if (n < cutoff)
+		return fib_serial(n);
+	std::future<long> result1 = std::async(std::launch::async, fib_std_async, n - 1);
+	const long result2 = fib_std_async(n - 2);
+	return result1.get() + result2;
+}
+
+double count_tasks(int n)
+{
+	return n < cutoff ? 0.0 : 1.0 + count_tasks(n - 1) + count_tasks(n - 2);
+}
+
+// Clearing the soft-dirty bits with 5 also resets VmHWM, Linux 4.0 and later.
+void reset_peak_rss()
+{
+	std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+// In bytes, 0 if unknown.
+double peak_rss()
+{
+	std::ifstream status("/proc/self/status");
+	std::string key;
+	while (status >> key)
+	{
+		if (key == "VmHWM:")
+		{
+			double kilobytes {0.0};
+			status >> kilobytes;
+			return kilobytes * 1024.0;
+		}
+		status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+	}
+	return 0.0;
+}
+
+struct Measurement
+{
+	double seconds {std::numeric_limits<double>::max()};
+	double peak_rss {0.0};
+};
+
+Measurement measure(const std::function<long()>& run, long expected)
+{
+	Measurement result;
+	for (int repetition = 0; repetition < num_repetitions; ++repetition)
+	{
+		reset_peak_rss();
+		const auto start = std::chrono::steady_clock::now();
+		const long value = run();
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		if (value != expected)
+			std::cerr << "fibonacci_benchmark: Got " << value << ", expected " << expected << '\n';
+		result.seconds = std::min(result.seconds, elapsed.count());
+		result.peak_rss = std::max(result.peak_rss, peak_rss());
+	}
+	return result;
+}
+
+void print_row(
+	int n, std::size_t workers, const std::string& variant, const Measurement& measurement,
+	double serial_seconds)
+{
+	std::cout << std::setw(4) << n << std::setw(9) << workers << std::setw(12) << variant
+			  << std::fixed << std::setprecision(2) << std::setw(12) << measurement.seconds * 1e3
+			  << std::setw(14) << count_tasks(n) / measurement.seconds / 1e6 << std::setw(10)
+			  << serial_seconds / measurement.seconds << std::setw(16)
+			  << measurement.peak_rss / (1024.0 * 1024.0) << '\n';
+}
+
+int main(int argc, char** argv)
+{
+	int max_n {35};
+	if (argc > 1)
+		max_n = std::stoi(argv[1]);
+	// Below 2 the recursion would run past fib(0) and fib(1).
+	if (argc > 2)
+		cutoff = std::max(std::stoi(argv[2]), 2);
+
+	std::vector<std::size_t> worker_counts;
+	const std::size_t max_workers = std::max(std::thread::hardware_concurrency(), 1u);
+	for (std::size_t workers = 1; workers < max_workers; workers *= 2)
+		worker_counts.push_back(workers);
+	worker_counts.push_back(max_workers);
+
+	std::cout << "Cutoff " << cutoff << ", best of " << num_repetitions << " runs.\n";
+	std::cout << std::setw(4) << "n" << std::setw(9) << "Workers" << std::setw(12) << "Variant"
+			  << std::setw(12) << "Time [ms]" << std::setw(14) << "Mtasks/s" << std::setw(10)
+			  << "Speedup" << std::setw(16) << "Peak RSS [MiB]" << '\n';
+	for (int n = std::min(20, max_n); n <= max_n; n += 5)
+	{
+		const long expected = fib_serial(n);
+		const Measurement serial = measure([n]() { return fib_serial(n); }, expected);
+		print_row(n, 1, "Serial", serial, serial.seconds);
+		if (count_tasks(n) <= max_std_async_tasks)
+		{
+			const Measurement std_async = measure([n]() { return fib_std_async(n); }, expected);
+			print_row(n, 0, "std::async", std_async, serial.seconds);
+		}
+		else
+		{
+			std::cout << std::setw(4) << n << std::setw(9) << 0 << std::setw(12) << "std::async"
+					  << "  skipped, " << std::fixed << std::setprecision(0) << count_tasks(n)
+					  << " threads would be needed\n";
+		}
+
+		for (std::size_t workers : worker_counts)
+		{
+			tf::Executor executor(workers);
+			long result {0};
+
+			tf::Taskflow subflow;
+			subflow.emplace([n, &result](tf::Subflow& sf) { result = fib_subflow(n, sf); });
+			const Measurement subflow_time = measure(
+				[&executor, &subflow, &result]()
+				{
+					executor.run(subflow).wait();
+					return result;
+				},
+				expected);
+			print_row(n, workers, "Subflow", subflow_time, serial.seconds);
+
+			tf::Taskflow async;
+			async.emplace([n, &executor, &result]() { result = fib_async(n, executor); });
+			const Measurement async_time = measure(
+				[&executor, &async, &result]()
+				{
+					executor.run(async).wait();
+					return result;
+				},
+				expected);
+			print_row(n, workers, "Async", async_time, serial.seconds);
+		}
+	}
+	std::cout << "std::async runs a thread per task, its worker count is shown as 0.\n";
+}
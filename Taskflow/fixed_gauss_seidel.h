@@ -0,0 +1,122 @@
+#pragma once
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+#include "taskflow/algorithm/for_each.hpp"
+
+// Standard library includes.
+#include <array>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+/// Gauss-Seidel for small dense systems whose size is known at compile time.
+///
+/// Every loop over rows and columns is expanded with a fold expression over an index sequence, so
+/// a solver for N unknowns is straight-line code with all indices constant, no loop counters and
+/// no branches other than the convergence check. Everything is constexpr, so small systems can be
+/// solved at compile time, see the static_assert at the end of this file.
+
+template <std::size_t N>
+struct FixedSystem
+{
+	std::array<std::array<double, N>, N> A {};
+	std::array<double, N> b {};
+	std::array<double, N> x {};
+	int iterations {0};
+};
+
+namespace fixed_gauss_seidel_detail
+{
+	template <typename F, std::size_t... I>
+	constexpr void unroll(F&& f, std::index_sequence<I...>)
+	{
+		(f(std::integral_constant<std::size_t, I> {}), ...);
+	}
+}
+
+/// Call f(std::integral_constant<std::size_t, I>) for I = 0, 1, ..., N - 1.
+template <std::size_t N, typename F>
+constexpr void unroll(F&& f)
+{
+	fixed_gauss_seidel_detail::unroll(f, std::make_index_sequence<N> {});
+}
+
+template <std::size_t N>
+constexpr std::array<double, N> computeResidual(const FixedSystem<N>& system)
+{
+	std::array<double, N> r {};
+	unroll<N>(
+		[&](auto i)
+		{
+			double Ax {0.0};
+			unroll<N>([&](auto j) { Ax += system.A[i][j] * system.x[j]; });
+			r[i] = Ax - system.b[i];
+		});
+	return r;
+}
+
+/// Squared so that it stays constexpr, std::sqrt isn't until C++26.
+template <std::size_t N>
+constexpr double normSquared(const std::array<double, N>& v)
+{
+	double sum {0.0};
+	unroll<N>([&](auto i) { sum += v[i] * v[i]; });
+	return sum;
+}
+
+template <std::size_t N>
+constexpr void updateX(FixedSystem<N>& system)
+{
+	unroll<N>(
+		[&](auto i)
+		{
+			constexpr std::size_t row = decltype(i)::value;
+			double sum {system.b[row]};
+			unroll<N>(
+				[&](auto column)
+				{
+					if constexpr (row != decltype(column)::value)
+						sum -= system.A[row][column] * system.x[column];
+				});
+			system.x[row] = sum / system.A[row][row];
+		});
+}
+
+/// Iterate from the current x until the residual norm is below tolerance or maxIterations sweeps
+/// have been made. Returns the number of sweeps, also stored in system.iterations.
+template <std::size_t N>
+constexpr int solve(FixedSystem<N>& system, int maxIterations = 16, double tolerance = 1e-6)
+{
+	system.iterations = 0;
+	while (system.iterations < maxIterations &&
+		   normSquared(computeResidual(system)) >= tolerance * tolerance)
+	{
+		updateX(system);
+		++system.iterations;
+	}
+	return system.iterations;
+}
+
+/// Add a task to `builder`, a tf::Taskflow or tf::Subflow, that solves all the given systems in
+/// parallel. The systems must stay alive, and in place, until the task has run.
+template <std::size_t N>
+tf::Task emplaceSolveBatch(
+	tf::FlowBuilder& builder, std::span<FixedSystem<N>> systems, int maxIterations = 16,
+	double tolerance = 1e-6)
+{
+	return builder.for_each_index(
+		std::size_t {0}, systems.size(), std::size_t {1},
+		[systems, maxIterations, tolerance](std::size_t i)
+		{ solve(systems[i], maxIterations, tolerance); });
+}
+
+static_assert(
+	[]()
+	{
+		FixedSystem<2> system {{{{2.0, 1.0}, {1.0, 3.0}}}, {3.0, 4.0}, {0.0, 0.0}};
+		solve(system, 100, 1e-12);
+		return normSquared(computeResidual(system)) < 1e-24;
+	}(),
+	"The fixed-size solver should be usable at compile time.");
@@ -0,0 +1,244 @@
+// Project includes
+#include "sparse.h"
+#include "utils.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <ios>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Solves AX = B for many right-hand sides that share the same A, in a single run of the same task
+// graph as gauss-seidel.cpp. The right-hand sides are interleaved as SIMD lanes, see the batched
+// kernels in sparse.h, so each sweep streams A through the cache once for the entire batch.
+//
+// Usage:
+//   gauss-seidel_batched <num unknowns>              Read right-hand sides from stdin until EOF.
+//   gauss-seidel_batched <num unknowns> <num rhs>    Generate random right-hand sides.
+
+std::size_t n {1000};
+std::size_t num_rhs {0};
+
+CsrMatrix A;
+RowColoring coloring;
+tf::Taskflow sweep;
+
+// Interleaved, element i of right-hand side l is at index i * num_rhs + l.
+std::vector<double> X;
+std::vector<double> B;
+std::vector<double> R;
+
+// Sum of squares of the residual per chunk and lane, lane l of chunk c at c * num_rhs + l.
+constexpr std::size_t residual_chunk_size {1024};
+std::vector<double> r_chunk_sums;
+std::vector<double> r_norms;
+
+int num_iterations {};
+constexpr int max_iterations {16};
+
+double next_double()
+{
+	static std::random_device dev;
+	static std::mt19937 rng(dev());
+	static std::uniform_real_distribution<double> dist(0.0, 1.0);
+	return dist(rng);
+}
+
+void random_A()
+{
+	A = randomStencilMatrix(n, next_double);
+}
+
+void color_A()
+{
+	coloring = colorRows(A);
+
+	sweep.clear();
+	tf::Task previous;
+	for (std::size_t color = 0; color < coloring.numColors(); ++color)
+	{
+		tf::Task update_color = sweep.for_each_index(
+			coloring.colorBegin[color], coloring.colorBegin[color + 1], std::size_t {1},
+			[](std::size_t i)
+			{ gaussSeidelRowBatched(A, X.data(), B.data(), num_rhs, coloring.rows[i]); });
+		update_color.name("Update color " + std::to_string(color));
+		if (!previous.empty())
+			previous.precede(update_color);
+		previous = update_color;
+	}
+}
+
+// Init x depends on Read b since the number of right-hand sides isn't known until they have been
+// read.
+void zero_x()
+{
+	X.assign(n * num_rhs, 0.0);
+	R.assign(n * num_rhs, 0.0);
+	r_chunk_sums.assign((n + residual_chunk_size - 1) / residual_chunk_size * num_rhs, 0.0);
+	r_norms.assign(num_rhs, 0.0);
+}
+
+void read_b()
+{
+	if (num_rhs > 0)
+	{
+		// Not next_double since Init A is using it concurrently.
+		std::mt19937 rng(std::random_device {}());
+		std::uniform_real_distribution<double> dist(0.0, 1.0);
+		B.resize(n * num_rhs);
+		for (double& value : B)
+			value = dist(rng);
+		return;
+	}
+
+	// n values per right-hand side until the input runs out. A last, partial one is padded with
+	// zeros, like GaussSeidel::initX pads a short b.
+	std::vector<double> read;
+	double value;
+	while (std::cin >> value)
+		read.push_back(value);
+	if (!std::cin.eof())
+		std::cerr << "gauss-seidel_batched: Stopped reading b at a value that isn't a number.\n";
+	num_rhs = (read.size() + n - 1) / n;
+	if (read.size() % n != 0)
+	{
+		std::cerr << "gauss-seidel_batched: The last right-hand side has " << read.size() % n
+				  << " of " << n << " values. Padding it with zeros.\n";
+		read.resize(n * num_rhs, 0.0);
+	}
+
+	// Interleave.
+	B.resize(n * num_rhs);
+	for (std::size_t rhs = 0; rhs < num_rhs; ++rhs)
+		for (std::size_t i = 0; i < n; ++i)
+			B[i * num_rhs + rhs] = read[rhs * n + i];
+}
+
+void compute_residual(tf::Subflow& subflow)
+{
+	subflow.for_each_index(
+		std::size_t {0}, n, residual_chunk_size,
+		[](std::size_t begin)
+		{
+			const std::size_t end = std::min(begin + residual_chunk_size, n);
+			double* lane_sums = r_chunk_sums.data() + begin / residual_chunk_size * num_rhs;
+			std::fill_n(lane_sums, num_rhs, 0.0);
+			computeResidualRowsBatched(
+				A, X.data(), B.data(), R.data(), num_rhs, begin, end, lane_sums);
+		});
+}
+
+void compute_norms()
+{
+	std::fill(r_norms.begin(), r_norms.end(), 0.0);
+	for (std::size_t chunk = 0; chunk < r_chunk_sums.size(); chunk += num_rhs)
+		for (std::size_t rhs = 0; rhs < num_rhs; ++rhs)
+			r_norms[rhs] += r_chunk_sums[chunk + rhs];
+	for (double& norm : r_norms)
+		norm = std::sqrt(norm);
+}
+
+double get_max_residual_norm()
+{
+	return r_norms.empty() ? 0.0 : *std::max_element(r_norms.begin(), r_norms.end());
+}
+
+// Loop until every right-hand side has converged.
+int should_loop()
+{
+	constexpr int loop_again {0};
+	constexpr int exit_loop {1};
+	if (num_iterations >= max_iterations || get_max_residual_norm() < 1e-6)
+	{
+		return exit_loop;
+	}
+	else
+	{
+		return loop_again;
+	}
+}
+
+int update_x(tf::Runtime& runtime)
+{
+	runtime.corun(sweep);
+	++num_iterations;
+	return 0;
+}
+
+void print_result()
+{
+	const std::size_t num_converged = static_cast<std::size_t>(
+		std::count_if(r_norms.begin(), r_norms.end(), [](double norm) { return norm < 1e-6; }));
+
+	std::cout << std::scientific << std::setprecision(4);
+	std::cout << '\n';
+	std::cout << "Unknowns: " << n << '\n';
+	std::cout << "Right-hand sides: " << num_rhs << '\n';
+	std::cout << "Colors: " << coloring.numColors() << '\n';
+	std::cout << "Iterations: " << num_iterations << '\n';
+	std::cout << "Converged: " << num_converged << " / " << num_rhs << '\n';
+	std::cout << "Max residual norm: " << get_max_residual_norm() << '\n';
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		n = std::stoul(argv[1]);
+	if (argc > 2)
+		num_rhs = std::stoul(argv[2]);
+	if (n == 0)
+	{
+		std::cerr << "Usage: gauss-seidel_batched <num unknowns> [num rhs], with at least one "
+					 "unknown.\n";
+		return 1;
+	}
+
+	tf::Executor executor;
+	tf::Taskflow taskflow;
+
+	tf::Task random_A = taskflow.emplace(::random_A);
+	tf::Task color_A = taskflow.emplace(::color_A);
+	tf::Task zero_x = taskflow.emplace(::zero_x);
+	tf::Task read_b = taskflow.emplace(::read_b);
+	tf::Task compute_residual = taskflow.emplace(::compute_residual);
+	tf::Task compute_norms = taskflow.emplace(::compute_norms);
+	tf::Task should_loop = taskflow.emplace(::should_loop);
+	tf::Task update_x = taskflow.emplace(::update_x);
+	tf::Task print_result = taskflow.emplace(::print_result);
+
+	random_A.precede(color_A);
+	read_b.precede(zero_x);
+	compute_residual.succeed(color_A, zero_x);
+	compute_residual.precede(compute_norms);
+	compute_norms.precede(should_loop);
+	should_loop.precede(update_x, print_result);
+	update_x.precede(compute_residual);
+
+	taskflow.name("Batched Gauss-Seidel");
+	random_A.name("Init A");
+	color_A.name("Color A");
+	zero_x.name("Init X");
+	read_b.name("Read B");
+	compute_residual.name("Compute Residual");
+	compute_norms.name("Compute Norms");
+	should_loop.name("Should loop");
+	update_x.name("Update X");
+	print_result.name("Print result");
+	dumpToFile(taskflow, "gauss-seidel_batched.dot");
+
+	const auto start = std::chrono::steady_clock::now();
+	executor.run(taskflow).wait();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Time: " << std::fixed << elapsed.count() << " s, "
+			  << elapsed.count() / double(std::max<std::size_t>(num_rhs, 1)) * 1e6
+			  << " us per right-hand side\n";
+}
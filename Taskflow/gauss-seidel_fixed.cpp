@@ -0,0 +1,138 @@
+// Project includes
+#include "fixed_gauss_seidel.h"
+#include "utils.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+// Solves a large batch of small dense systems, 2x2, 4x4 and 8x8, with the compile-time sized
+// solver in fixed_gauss_seidel.h. Each size gets a Generate -> Solve -> Report chain in a single
+// taskflow, and the Solve tasks spread the systems over all workers. The sizes are generated
+// concurrently before the first solve starts, solved one after the other, and reported after the
+// last solve stops, so that nothing else runs during a timed solve.
+//
+// Usage:
+//   gauss-seidel_fixed [num systems per size]
+
+std::size_t num_systems {1'000'000};
+
+template <std::size_t N>
+struct Batch
+{
+	std::vector<FixedSystem<N>> systems;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point stop;
+};
+
+template <std::size_t N>
+void generate(Batch<N>& batch, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> dist(0.0, 1.0);
+	batch.systems.resize(num_systems);
+	for (FixedSystem<N>& system : batch.systems)
+	{
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			double off_diagonal_sum {0.0};
+			for (std::size_t j = 0; j < N; ++j)
+			{
+				system.A[i][j] = dist(rng);
+				off_diagonal_sum += i != j ? system.A[i][j] : 0.0;
+			}
+			// Make diagonal larger to get a better condition number.
+			system.A[i][i] = off_diagonal_sum + dist(rng) + dist(rng);
+			system.b[i] = dist(rng);
+		}
+	}
+}
+
+template <std::size_t N>
+void report(const Batch<N>& batch)
+{
+	const std::chrono::duration<double> elapsed = batch.stop - batch.start;
+	std::size_t total_iterations {0};
+	std::size_t num_converged {0};
+	for (const FixedSystem<N>& system : batch.systems)
+	{
+		total_iterations += std::size_t(system.iterations);
+		num_converged += normSquared(computeResidual(system)) < 1e-12 ? 1 : 0;
+	}
+
+	bufferedCout() << N << 'x' << N << ": " << batch.systems.size() << " systems in "
+				 << std::fixed << std::setprecision(4) << elapsed.count() << " s, "
+				 << std::scientific << std::setprecision(3)
+				 << double(batch.systems.size()) / elapsed.count() << " systems/s, "
+				 << std::fixed << std::setprecision(2)
+				 << double(total_iterations) / double(batch.systems.size())
+				 << " iterations on average, " << num_converged << " converged\n";
+}
+
+// Generate precedes `generated`, which precedes Start, and Report succeeds `solved`, which the
+// last batch's Stop should precede. Returns the Stop task, which the next batch's Start task
+// should succeed.
+template <std::size_t N>
+tf::Task emplaceBatch(
+	tf::Taskflow& taskflow, Batch<N>& batch, tf::Task previous_stop, tf::Task generated,
+	tf::Task solved)
+{
+	const std::string size = std::to_string(N) + "x" + std::to_string(N);
+	tf::Task generate = taskflow.emplace([&batch]() { ::generate(batch, N); });
+	tf::Task start =
+		taskflow.emplace([&batch]() { batch.start = std::chrono::steady_clock::now(); });
+	// The span is created when the solve task runs, after Generate has filled the vector.
+	tf::Task solve = taskflow.emplace(
+		[&batch](tf::Subflow& subflow)
+		{ emplaceSolveBatch<N>(subflow, std::span<FixedSystem<N>>(batch.systems)); });
+	tf::Task stop =
+		taskflow.emplace([&batch]() { batch.stop = std::chrono::steady_clock::now(); });
+	tf::Task report = taskflow.emplace([&batch]() { ::report(batch); });
+
+	generate.precede(generated);
+	generated.precede(start);
+	start.precede(solve);
+	solve.precede(stop);
+	solved.precede(report);
+	if (!previous_stop.empty())
+		previous_stop.precede(start);
+
+	generate.name("Generate " + size);
+	start.name("Start " + size);
+	solve.name("Solve " + size);
+	stop.name("Stop " + size);
+	report.name("Report " + size);
+	return stop;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		num_systems = std::stoul(argv[1]);
+
+	tf::Executor executor;
+	tf::Taskflow taskflow;
+	taskflow.name("Fixed-Size Gauss-Seidel");
+
+	Batch<2> batch2;
+	Batch<4> batch4;
+	Batch<8> batch8;
+	tf::Task generated = taskflow.emplace([]() {}).name("Generated");
+	tf::Task solved = taskflow.emplace([]() {}).name("Solved");
+	tf::Task stop = emplaceBatch(taskflow, batch2, tf::Task(), generated, solved);
+	stop = emplaceBatch(taskflow, batch4, stop, generated, solved);
+	stop = emplaceBatch(taskflow, batch8, stop, generated, solved);
+	stop.precede(solved);
+	dumpToFile(taskflow, "gauss-seidel_fixed.dot");
+
+	executor.run(taskflow).wait();
+}
@@ -0,0 +1,101 @@
+// Project includes
+#include "gauss_seidel.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Compares the time per iteration of the Gauss-Seidel graph with one task per step, where every
+// iteration makes four trips through the scheduler and sweeps in parallel, against the fused
+// graph, where one serial task runs several iterations, for a range of system sizes. The size at
+// which the unfused graph starts to win is the crossover point.
+//
+// The time per iteration is the difference between a run with many iterations and a run with
+// none, on the same matrix, divided by the number of iterations. That cancels the setup cost.
+//
+// Usage:
+//   gauss-seidel_fused_benchmark [max num unknowns]
+
+constexpr int num_iterations {64};
+constexpr int num_repetitions {3};
+
+double timeRun(tf::Executor& executor, std::size_t n, int fused_sweeps, int max_iterations)
+{
+	GaussSeidel::Options options;
+	options.numUnknowns = n;
+	options.maxIterations = max_iterations;
+	// Never converge, so that every run makes exactly max_iterations iterations.
+	options.tolerance = 0.0;
+	options.seed = 1;
+	options.printReport = false;
+	options.fusedSweeps = fused_sweeps;
+	options.trajectory.capacity = 1;
+
+	double best {std::numeric_limits<double>::max()};
+	for (int repetition = 0; repetition < num_repetitions; ++repetition)
+	{
+		GaussSeidel solver(options);
+		const auto start = std::chrono::steady_clock::now();
+		executor.run(solver.taskflow()).wait();
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+double timePerIteration(tf::Executor& executor, std::size_t n, int fused_sweeps)
+{
+	const double setup = timeRun(executor, n, fused_sweeps, 0);
+	const double total = timeRun(executor, n, fused_sweeps, num_iterations);
+	return std::max(total - setup, 0.0) / num_iterations;
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t max_n {1 << 20};
+	if (argc > 1)
+		max_n = std::stoul(argv[1]);
+
+	const std::vector<int> fused_sweeps {0, 1, 4, 16};
+
+	tf::Executor executor;
+	std::cout << "Microseconds per iteration, " << executor.num_workers() << " workers.\n";
+	std::cout << std::setw(10) << "Unknowns";
+	for (int sweeps : fused_sweeps)
+	{
+		const std::string mode = sweeps == 0 ? "Unfused" : "Fused " + std::to_string(sweeps);
+		std::cout << std::setw(12) << mode;
+	}
+	std::cout << '\n';
+
+	std::size_t crossover {0};
+	for (std::size_t n = 16; n <= max_n; n *= 4)
+	{
+		std::vector<double> times;
+		for (int sweeps : fused_sweeps)
+			times.push_back(timePerIteration(executor, n, sweeps));
+
+		std::cout << std::setw(10) << n << std::fixed << std::setprecision(2);
+		for (double time : times)
+			std::cout << std::setw(12) << time * 1e6;
+		std::cout << '\n';
+
+		const double best_fused = *std::min_element(times.begin() + 1, times.end());
+		if (crossover == 0 && times[0] < best_fused)
+			crossover = n;
+	}
+
+	if (crossover != 0)
+		std::cout << "The unfused graph is faster from " << crossover << " unknowns.\n";
+	else
+		std::cout << "The fused graph is faster for every size tested.\n";
+}
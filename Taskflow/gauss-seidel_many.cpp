@@ -0,0 +1,78 @@
+// Project includes
+#include "gauss_seidel.h"
+#include "utils.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Runs many independent Gauss-Seidel solves on a single executor, first one at a time and then
+// all at once, and compares the wall time. Each solve spends much of its time in the serial
+// Compute Residual -> Should loop -> Update x chain, which the concurrent solves fill with work.
+//
+// Usage:
+//   gauss-seidel_many [num solves] [num unknowns]
+
+std::vector<std::unique_ptr<GaussSeidel>> makeSolvers(std::size_t num_solves, std::size_t n)
+{
+	std::vector<std::unique_ptr<GaussSeidel>> solvers;
+	for (std::size_t i = 0; i < num_solves; ++i)
+	{
+		GaussSeidel::Options options;
+		options.name = "Solve " + std::to_string(i);
+		options.numUnknowns = n;
+		options.rightHandSide = GaussSeidel::RightHandSide::Random;
+		options.seed = unsigned(i + 1);
+		options.trajectory.capacity = std::size_t(options.maxIterations) + 1;
+		options.printReport = false;
+		solvers.push_back(std::make_unique<GaussSeidel>(options));
+	}
+	return solvers;
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t num_solves {16};
+	std::size_t n {10'000};
+	if (argc > 1)
+		num_solves = std::stoul(argv[1]);
+	if (argc > 2)
+		n = std::stoul(argv[2]);
+
+	tf::Executor executor;
+
+	std::vector<std::unique_ptr<GaussSeidel>> serial_solvers = makeSolvers(num_solves, n);
+	const auto serial_start = std::chrono::steady_clock::now();
+	for (std::unique_ptr<GaussSeidel>& solver : serial_solvers)
+		executor.run(solver->taskflow()).wait();
+	const std::chrono::duration<double> serial_time =
+		std::chrono::steady_clock::now() - serial_start;
+
+	std::vector<std::unique_ptr<GaussSeidel>> concurrent_solvers = makeSolvers(num_solves, n);
+	const auto concurrent_start = std::chrono::steady_clock::now();
+	for (std::unique_ptr<GaussSeidel>& solver : concurrent_solvers)
+		executor.run(solver->taskflow());
+	executor.wait_for_all();
+	const std::chrono::duration<double> concurrent_time =
+		std::chrono::steady_clock::now() - concurrent_start;
+
+	std::size_t num_converged {0};
+	for (const std::unique_ptr<GaussSeidel>& solver : concurrent_solvers)
+		num_converged += solver->converged() ? 1 : 0;
+
+	std::cout << std::fixed << std::setprecision(4);
+	std::cout << "Solves: " << num_solves << " with " << n << " unknowns each, "
+			  << executor.num_workers() << " workers\n";
+	std::cout << "One at a time: " << serial_time.count() << " s\n";
+	std::cout << "All at once:   " << concurrent_time.count() << " s\n";
+	std::cout << "Speedup: " << serial_time.count() / concurrent_time.count() << '\n';
+	std::cout << "Converged: " << num_converged << " / " << num_solves << '\n';
+}
@@ -0,0 +1,76 @@
+// Project includes
+#include "gauss_seidel.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Compares Gauss-Seidel in double precision against mixed-precision iterative refinement with one
+// and two single precision sweeps per step, on the same system. Reports the iterations needed to
+// reach the residual tolerance and the time per iteration, which for a large system is dominated
+// by the memory traffic of the sweep.
+//
+// The time per iteration is the difference between the solve and a run with no iterations, which
+// cancels the setup cost, divided by the number of iterations.
+//
+// Usage:
+//   gauss-seidel_mixed [num unknowns]
+
+struct Run
+{
+	int iterations;
+	double residual_norm;
+	double seconds;
+};
+
+Run solve(tf::Executor& executor, std::size_t n, int mixed_precision_sweeps, int max_iterations)
+{
+	GaussSeidel::Options options;
+	options.numUnknowns = n;
+	options.maxIterations = max_iterations;
+	options.seed = 1;
+	options.rightHandSide = GaussSeidel::RightHandSide::Random;
+	options.printReport = false;
+	options.mixedPrecisionSweeps = mixed_precision_sweeps;
+	options.trajectory.capacity = 1;
+
+	GaussSeidel solver(options);
+	const auto start = std::chrono::steady_clock::now();
+	executor.run(solver.taskflow()).wait();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return {solver.numIterations(), solver.residualNorm(), elapsed.count()};
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t n {1 << 21};
+	if (argc > 1)
+		n = std::stoul(argv[1]);
+
+	tf::Executor executor;
+	std::cout << "Unknowns: " << n << ", " << executor.num_workers() << " workers\n";
+	std::cout << std::left << std::setw(24) << "Mode" << std::right << std::setw(12)
+			  << "Iterations" << std::setw(14) << "Residual" << std::setw(20)
+			  << "Time/iteration (ms)" << '\n';
+	for (int sweeps : {0, 1, 2})
+	{
+		const Run setup = solve(executor, n, sweeps, 0);
+		const Run run = solve(executor, n, sweeps, 64);
+		const double per_iteration =
+			std::max(run.seconds - setup.seconds, 0.0) / std::max(run.iterations, 1);
+		const std::string mode =
+			sweeps == 0 ? "Double" : "Mixed, " + std::to_string(sweeps) + " float sweeps";
+		std::cout << std::left << std::setw(24) << mode << std::right << std::setw(12)
+				  << run.iterations << std::setw(14) << std::scientific << std::setprecision(3)
+				  << run.residual_norm << std::setw(20) << std::fixed << std::setprecision(3)
+				  << per_iteration * 1e3 << '\n';
+	}
+}
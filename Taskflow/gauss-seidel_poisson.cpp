@@ -0,0 +1,256 @@
+// Project includes
+#include "utils.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+#include "taskflow/algorithm/for_each.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Solves the 2D Poisson equation -Laplace(u) = f on the unit square, with u = 0 on the boundary,
+// using the five-point stencil and lexicographic Gauss-Seidel.
+//
+// Instead of one Update x task that sweeps the whole grid, the grid is tiled into blocks small
+// enough to stay in cache, and every block update of every sweep is a task of its own. A block
+// needs the new values of its north and west neighbors and the old values of its south and east
+// neighbors, so block (i, j) of sweep k succeeds blocks (i - 1, j) and (i, j - 1) of sweep k and
+// blocks (i + 1, j) and (i, j + 1) of sweep k - 1. That forms diagonal wavefronts which pipeline
+// across sweeps: sweep k + 1 starts in the top left corner while sweep k is still working its
+// way to the bottom right. Every point sees exactly the values it would in a serial
+// lexicographic sweep, so the iterates are the same as the serial solver's.
+//
+// Update x runs sweeps_per_pass sweeps of that graph at a time, so convergence is checked every
+// sweeps_per_pass sweeps. The last pass runs only the sweeps left before max sweeps.
+//
+// Usage:
+//   gauss-seidel_poisson [grid size] [block size] [max sweeps]
+
+std::size_t n {1024};
+std::size_t block_size {64};
+std::size_t num_blocks {};
+int max_sweeps {256};
+constexpr int sweeps_per_pass {4};
+constexpr double tolerance {1e-6};
+
+// (n + 2) x (n + 2), row major, including the boundary.
+std::vector<double> u;
+std::vector<double> f;
+double h2 {};
+
+std::vector<double> r_block_row_sums;
+double initial_residual_norm {};
+int num_sweeps {};
+
+tf::Taskflow wavefront;
+// The max_sweeps % sweeps_per_pass sweeps of the last pass, if any.
+tf::Taskflow last_wavefront;
+
+std::size_t at(std::size_t i, std::size_t j)
+{
+	return i * (n + 2) + j;
+}
+
+void init_f()
+{
+	f.assign((n + 2) * (n + 2), 1.0);
+	h2 = 1.0 / double((n + 1) * (n + 1));
+}
+
+void zero_u()
+{
+	u.assign((n + 2) * (n + 2), 0.0);
+	r_block_row_sums.assign(num_blocks, 0.0);
+	initial_residual_norm = 0.0;
+	num_sweeps = 0;
+}
+
+// Rows and columns [1 + block * block_size, ...) of the interior.
+void update_block(std::size_t block_row, std::size_t block_column)
+{
+	const std::size_t row_begin = 1 + block_row * block_size;
+	const std::size_t row_end = std::min(row_begin + block_size, n + 1);
+	const std::size_t column_begin = 1 + block_column * block_size;
+	const std::size_t column_end = std::min(column_begin + block_size, n + 1);
+	for (std::size_t i = row_begin; i < row_end; ++i)
+	{
+		for (std::size_t j = column_begin; j < column_end; ++j)
+		{
+			u[at(i, j)] = 0.25 * (h2 * f[at(i, j)] + u[at(i - 1, j)] + u[at(i + 1, j)] +
+								  u[at(i, j - 1)] + u[at(i, j + 1)]);
+		}
+	}
+}
+
+void emplace_sweeps(tf::Taskflow& graph, int num_graph_sweeps)
+{
+	graph.clear();
+	// Tasks of the previous and the current sweep, block (i, j) at i * num_blocks + j.
+	std::vector<tf::Task> previous;
+	std::vector<tf::Task> current(num_blocks * num_blocks);
+	for (int sweep = 0; sweep < num_graph_sweeps; ++sweep)
+	{
+		for (std::size_t i = 0; i < num_blocks; ++i)
+		{
+			for (std::size_t j = 0; j < num_blocks; ++j)
+			{
+				tf::Task block = graph.emplace([i, j]() { update_block(i, j); });
+				block.name(
+					"Sweep " + std::to_string(sweep) + " block " + std::to_string(i) + ", " +
+					std::to_string(j));
+				if (i > 0)
+					block.succeed(current[(i - 1) * num_blocks + j]);
+				if (j > 0)
+					block.succeed(current[i * num_blocks + j - 1]);
+				if (!previous.empty())
+				{
+					const bool last_row = i + 1 == num_blocks;
+					const bool last_column = j + 1 == num_blocks;
+					if (!last_row)
+						block.succeed(previous[(i + 1) * num_blocks + j]);
+					if (!last_column)
+						block.succeed(previous[i * num_blocks + j + 1]);
+					// The bottom right block has no south or east neighbor to order it after its
+					// own previous update.
+					if (last_row && last_column)
+						block.succeed(previous[i * num_blocks + j]);
+				}
+				current[i * num_blocks + j] = block;
+			}
+		}
+		previous = current;
+	}
+}
+
+void tile_grid()
+{
+	num_blocks = (n + block_size - 1) / block_size;
+	emplace_sweeps(wavefront, sweeps_per_pass);
+	emplace_sweeps(last_wavefront, std::max(max_sweeps, 0) % sweeps_per_pass);
+}
+
+// Residual of -Laplace(u) = f, scaled by h^2 so that it is in the units of the update.
+void compute_residual(tf::Subflow& subflow)
+{
+	subflow.for_each_index(
+		std::size_t {0}, num_blocks, std::size_t {1},
+		[](std::size_t block_row)
+		{
+			const std::size_t row_begin = 1 + block_row * block_size;
+			const std::size_t row_end = std::min(row_begin + block_size, n + 1);
+			double sum {0.0};
+			for (std::size_t i = row_begin; i < row_end; ++i)
+			{
+				for (std::size_t j = 1; j <= n; ++j)
+				{
+					const double r = h2 * f[at(i, j)] - 4.0 * u[at(i, j)] + u[at(i - 1, j)] +
+									 u[at(i + 1, j)] + u[at(i, j - 1)] + u[at(i, j + 1)];
+					sum += r * r;
+				}
+			}
+			r_block_row_sums[block_row] = sum;
+		});
+}
+
+double get_residual_norm()
+{
+	return std::sqrt(std::accumulate(r_block_row_sums.begin(), r_block_row_sums.end(), 0.0));
+}
+
+// Relative to the residual of the initial guess.
+int should_loop()
+{
+	constexpr int loop_again {0};
+	constexpr int exit_loop {1};
+	if (num_sweeps == 0)
+		initial_residual_norm = get_residual_norm();
+	if (num_sweeps >= max_sweeps || get_residual_norm() <= tolerance * initial_residual_norm)
+	{
+		return exit_loop;
+	}
+	else
+	{
+		return loop_again;
+	}
+}
+
+int update_x(tf::Runtime& runtime)
+{
+	// num_sweeps is a multiple of sweeps_per_pass, so what is left is last_wavefront's sweeps.
+	if (max_sweeps - num_sweeps < sweeps_per_pass)
+	{
+		runtime.corun(last_wavefront);
+		num_sweeps = max_sweeps;
+	}
+	else
+	{
+		runtime.corun(wavefront);
+		num_sweeps += sweeps_per_pass;
+	}
+	return 0;
+}
+
+void print_result()
+{
+	std::cout << std::scientific << std::setprecision(4);
+	std::cout << '\n';
+	std::cout << "Grid: " << n << " x " << n << '\n';
+	std::cout << "Blocks: " << num_blocks << " x " << num_blocks << " of " << block_size << " x "
+			  << block_size << '\n';
+	std::cout << "Sweeps: " << num_sweeps << '\n';
+	std::cout << "Residual norm: " << get_residual_norm() << ", "
+			  << get_residual_norm() / initial_residual_norm << " of the initial\n";
+	std::cout << "u at the center: " << u[at((n + 1) / 2, (n + 1) / 2)] << '\n';
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		n = std::stoul(argv[1]);
+	if (argc > 2)
+		block_size = std::max<std::size_t>(std::stoul(argv[2]), 1);
+	if (argc > 3)
+		max_sweeps = std::stoi(argv[3]);
+
+	tf::Executor executor;
+	tf::Taskflow taskflow;
+
+	tf::Task init_f = taskflow.emplace(::init_f);
+	tf::Task tile_grid = taskflow.emplace(::tile_grid);
+	tf::Task zero_u = taskflow.emplace(::zero_u);
+	tf::Task compute_residual = taskflow.emplace(::compute_residual);
+	tf::Task should_loop = taskflow.emplace(::should_loop);
+	tf::Task update_x = taskflow.emplace(::update_x);
+	tf::Task print_result = taskflow.emplace(::print_result);
+
+	// Init u sizes the residual sums after the number of blocks.
+	tile_grid.precede(zero_u);
+	compute_residual.succeed(init_f, zero_u);
+	compute_residual.precede(should_loop);
+	should_loop.precede(update_x, print_result);
+	update_x.precede(compute_residual);
+
+	taskflow.name("Poisson Gauss-Seidel");
+	init_f.name("Init f");
+	tile_grid.name("Tile grid");
+	zero_u.name("Init u");
+	compute_residual.name("Compute Residual");
+	should_loop.name("Should loop");
+	update_x.name("Update x");
+	print_result.name("Print result");
+	dumpToFile(taskflow, "gauss-seidel_poisson.dot");
+
+	const auto start = std::chrono::steady_clock::now();
+	executor.run(taskflow).wait();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Time: " << std::fixed << elapsed.count() << " s, "
+			  << elapsed.count() / std::max(num_sweeps, 1) * 1e3 << " ms per sweep\n";
+}
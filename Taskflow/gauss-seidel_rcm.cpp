@@ -0,0 +1,87 @@
+// Project includes
+#include "gauss_seidel.h"
+#include "reordering.h"
+#include "sparse.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+// Solves a system whose unknowns are numbered randomly, as they often are in matrices assembled
+// from unstructured meshes, with and without the reverse Cuthill-McKee reordering of
+// GaussSeidel::Options::reorder, and reports the bandwidth and the time per iteration of both.
+//
+// The time per iteration is the difference between a run with max iterations and a run with none,
+// divided by the number of iterations, which cancels the setup cost, including the reordering
+// itself, which is reported separately.
+//
+// Usage:
+//   gauss-seidel_rcm [num unknowns]
+
+constexpr int num_iterations {32};
+
+double time_run(tf::Executor& executor, const CsrMatrix& A, bool reorder, int max_iterations)
+{
+	GaussSeidel::Options options;
+	options.matrix = &A;
+	options.maxIterations = max_iterations;
+	// Never converge, so that every run makes exactly max_iterations iterations.
+	options.tolerance = 0.0;
+	options.seed = 1;
+	options.rightHandSide = GaussSeidel::RightHandSide::Random;
+	options.printReport = false;
+	options.trajectory.capacity = 1;
+	options.reorder = reorder;
+
+	GaussSeidel solver(options);
+	const auto start = std::chrono::steady_clock::now();
+	executor.run(solver.taskflow()).wait();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t n {1 << 21};
+	if (argc > 1)
+		n = std::stoul(argv[1]);
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> dist(0.0, 1.0);
+	const CsrMatrix stencil = randomStencilMatrix(n, [&rng, &dist]() { return dist(rng); });
+	std::vector<std::uint32_t> shuffle(n);
+	std::iota(shuffle.begin(), shuffle.end(), std::uint32_t {0});
+	std::shuffle(shuffle.begin(), shuffle.end(), rng);
+	const CsrMatrix A = permuteSymmetric(stencil, shuffle);
+	const CsrMatrix reordered = permuteSymmetric(A, reverseCuthillMcKee(A));
+
+	tf::Executor executor;
+	double setup[2] {};
+	double per_iteration[2] {};
+	for (bool reorder : {false, true})
+	{
+		setup[reorder] = time_run(executor, A, reorder, 0);
+		const double total = time_run(executor, A, reorder, num_iterations);
+		per_iteration[reorder] = std::max(total - setup[reorder], 0.0) / num_iterations;
+	}
+
+	std::cout << "Unknowns: " << n << ", " << executor.num_workers() << " workers\n";
+	std::cout << "Bandwidth: " << bandwidth(A) << ", " << bandwidth(reordered)
+			  << " after reverse Cuthill-McKee\n";
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Time per iteration: " << per_iteration[0] * 1e3 << " ms, "
+			  << per_iteration[1] * 1e3 << " ms reordered\n";
+	std::cout << "Speedup: " << per_iteration[0] / per_iteration[1] << '\n';
+	std::cout << "Reordering cost: " << std::max(setup[1] - setup[0], 0.0) * 1e3 << " ms\n";
+}
@@ -0,0 +1,77 @@
+// Project includes
+#include "gauss_seidel.h"
+#include "solution_cache.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Solves the same A for a sequence of slowly changing right-hand sides, as happens when stepping a
+// simulation, with every solve warm-started from the cached solution of the closest previous b.
+// The first solve starts from x = 0 and sets the baseline for the iterations saved.
+//
+// Usage:
+//   gauss-seidel_warm [num solves] [num unknowns] [relative change of b per solve]
+
+int main(int argc, char** argv)
+{
+	std::size_t num_solves {8};
+	std::size_t n {10'000};
+	double change {1e-6};
+	if (argc > 1)
+		num_solves = std::stoul(argv[1]);
+	if (argc > 2)
+		n = std::stoul(argv[2]);
+	if (argc > 3)
+		change = std::stod(argv[3]);
+
+	std::mt19937 rng(2);
+	std::uniform_real_distribution<double> dist(-1.0, 1.0);
+	std::vector<double> b(n);
+	for (double& value : b)
+		value = 1.0 + dist(rng);
+
+	tf::Executor executor;
+	SolutionCache cache;
+
+	std::cout << std::setw(6) << "Solve" << std::setw(12) << "Iterations" << std::setw(8) << "Saved"
+			  << std::setw(14) << "Residual" << '\n';
+	int total_saved {0};
+	for (std::size_t solve = 0; solve < num_solves; ++solve)
+	{
+		GaussSeidel::Options options;
+		options.name = "Solve " + std::to_string(solve);
+		options.numUnknowns = n;
+		// Enough for the cold solve to converge, so that it is a fair baseline.
+		options.maxIterations = 64;
+		// The same seed every time, so every solve gets the same A.
+		options.seed = 1;
+		options.rightHandSide = GaussSeidel::RightHandSide::Values;
+		options.rightHandSideValues = b;
+		options.trajectory.capacity = 1;
+		options.printReport = false;
+		options.warmStartCache = &cache;
+
+		GaussSeidel solver(options);
+		executor.run(solver.taskflow()).wait();
+
+		const std::optional<int> saved = solver.iterationsSaved();
+		total_saved += saved.value_or(0);
+		std::cout << std::setw(6) << solve << std::setw(12) << solver.numIterations()
+				  << std::setw(8) << (saved ? std::to_string(*saved) : "-") << std::setw(14)
+				  << std::scientific << std::setprecision(3) << solver.residualNorm() << '\n';
+
+		// Every element by up to `change` of itself.
+		for (double& value : b)
+			value += change * value * dist(rng);
+	}
+	std::cout << "Iterations saved in total: " << total_saved << '\n';
+}
@@ -0,0 +1,782 @@
+#pragma once
+
+// Project includes
+#include "matrix_loader.h"
+#include "reordering.h"
+#include "solution_cache.h"
+#include "sparse.h"
+#include "trajectory_recorder.h"
+#include "utils.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <ios>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// A multi-color sparse Gauss-Seidel solve of Ax = b.
+///
+/// Each instance owns all of its state, A, x, b, the coloring, the trajectory, and the taskflow
+/// that runs the Init A -> Compute Residual -> Should loop -> Update x loop on it. Any number of
+/// instances can therefore run at the same time on a single executor, and their sweeps will share
+/// the workers.
+///
+/// With Options::fusedSweeps set the per-iteration chain of four tasks is replaced by a single
+/// Sweep and check task that computes the residual, records the trajectory, checks for convergence
+/// and updates x serially, for up to fusedSweeps iterations, before handing back to Should loop.
+/// That trades the parallel sweep for fewer trips through the scheduler, which pays off for small
+/// and medium systems, see gauss-seidel_fused_benchmark.cpp.
+///
+/// With Options::mixedPrecisionSweeps set Update x is a step of mixed-precision iterative
+/// refinement instead, solving for the correction to x with sweeps in single precision, while the
+/// residual and x stay in double precision. Only the values shrink, the sweeps still read a 32-bit
+/// column per nonzero, so they stream 8 rather than 12 bytes per nonzero, and every step adds a
+/// Round residual and an Apply correction pass over the vectors, so the gain is modest.
+///
+/// A and b can be loaded from Matrix Market or binary files, see matrix_loader.h, in which case
+/// Init A and Read b parse them in parallel chunks in their subflows. A loaded A decides the
+/// number of unknowns and must, like the generated one, be structurally symmetric with a non-zero
+/// diagonal. If either file can't be loaded the solve fails: Should loop exits at once, the report
+/// says what failed, and failed() returns true.
+///
+/// With Options::reorder set Init A renumbers the unknowns in reverse Cuthill-McKee order, which
+/// puts the neighbors of every row close to it, so that the sweeps touch x in a cache-friendly
+/// order. Init x moves b into that order and Restore order moves x back before Print result.
+///
+/// With Options::warmStartCache set Init x seeds x with the cached solution of the same A whose b
+/// is closest to this b, instead of zero, and Print result stores the new solution in the cache.
+/// When b changes only slightly between solves that takes far fewer iterations.
+///
+/// An instance may not be moved since the tasks refer back to it.
+class GaussSeidel
+{
+public:
+	enum class RightHandSide
+	{
+		// Prompt for every element on stdin. Only usable with a single solver running.
+		Interactive,
+		// Alternating 2 and 8, the hard-coded values in the original 2x2 example.
+		Alternating,
+		Random,
+		// Loaded from Options::rightHandSidePath.
+		File,
+		// Options::rightHandSideValues.
+		Values,
+	};
+
+	struct Options
+	{
+		std::string name {"Gauss-Seidel"};
+		// Ignored when matrix or matrixPath is set.
+		std::size_t numUnknowns {2};
+		// Use a copy of this A instead of generating one.
+		const CsrMatrix* matrix {nullptr};
+		// Load A from this file instead of generating it.
+		std::filesystem::path matrixPath {};
+		// The file read by RightHandSide::File.
+		std::filesystem::path rightHandSidePath {};
+		// The b used by RightHandSide::Values.
+		std::vector<double> rightHandSideValues {};
+		int maxIterations {16};
+		double tolerance {1e-6};
+		RightHandSide rightHandSide {RightHandSide::Alternating};
+		// Zero means a random seed.
+		unsigned seed {0};
+		// The number of elements is capped to the number of unknowns.
+		TrajectoryRecorder::Options trajectory {};
+		// Whether Print result writes the report to stdout.
+		bool printReport {true};
+		// Zero for one task per step of the iteration, otherwise the maximum number of iterations
+		// run by each Sweep and check task.
+		int fusedSweeps {0};
+		// Zero to sweep in double precision, otherwise the number of single precision sweeps per
+		// refinement step. Ignored with fusedSweeps.
+		int mixedPrecisionSweeps {0};
+		// Reorder the unknowns to reduce the bandwidth of A. The trajectory records x in the
+		// reordered order.
+		bool reorder {false};
+		// Seed x from, and store the solution in, this cache. May be shared between solvers.
+		SolutionCache* warmStartCache {nullptr};
+	};
+
+	explicit GaussSeidel(const Options& options);
+	GaussSeidel(const GaussSeidel&) = delete;
+	GaussSeidel& operator=(const GaussSeidel&) = delete;
+
+	/// The solver's task graph, run it with tf::Executor::run or embed it with composed_of.
+	tf::Taskflow& taskflow();
+
+	// Task callbacks.
+	void initA(tf::Subflow& subflow);
+	void colorA();
+	void initX();
+	void readB(tf::Subflow& subflow);
+	void computeResidual(tf::Subflow& subflow);
+	void recordTrajectory();
+	int shouldLoop();
+	int updateX(tf::Runtime& runtime);
+	void sweepAndCheck();
+	void restoreOrder();
+	void printResult();
+
+	// Results.
+	const std::string& name() const;
+	int numIterations() const;
+	double residualNorm() const;
+	bool converged() const;
+	/// Whether A or b could not be loaded, in which case nothing was solved.
+	bool failed() const;
+	const std::vector<double>& x() const;
+	bool warmStarted() const;
+	/// Iterations saved by the warm start compared to the last solve of A from x = 0, if any.
+	std::optional<int> iterationsSaved() const;
+
+	/// Write the solution report printed by the Print result task.
+	void writeReport(std::ostream& stream);
+
+private:
+	double nextDouble();
+	bool done() const;
+	void computeResidualSerial();
+	void storeSolution();
+	bool initXAfterReadB() const;
+	void orderInitTasks(tf::Task initA, tf::Task initX, tf::Task readB) const;
+	void emplaceTasks();
+	void emplaceFusedTasks();
+	void emplaceRefinementStep();
+	tf::Task emplaceRestoreOrder(tf::Task printResult);
+	void reorderA();
+
+private:
+	// The residual is computed in chunks of this many rows, each chunk writing the sum of squares
+	// of its residual elements to m_rChunkSums. The norm is the square root of the sum of those.
+	static constexpr std::size_t s_residualChunkSize {4096};
+
+	// Systems at most this large are printed in full and read interactively.
+	static constexpr std::size_t s_maxPrintedSize {8};
+
+	// Files are split into at most this many chunks for parsing.
+	static constexpr std::size_t s_numLoadChunks {64};
+
+	Options m_options;
+	std::mt19937 m_rng;
+
+	// Options::numUnknowns, or the size of the loaded A once Init A has run.
+	std::size_t m_numUnknowns;
+
+	CsrMatrix m_A;
+	std::vector<double> m_x;
+	std::vector<double> m_b;
+	std::vector<double> m_r;
+	std::vector<double> m_rChunkSums;
+
+	// Rows of A grouped so that rows of the same color can be updated in parallel.
+	RowColoring m_coloring;
+
+	// One parallel-for per color, chained in color order, or a refinement step. Built by colorA
+	// and run by updateX.
+	tf::Taskflow m_sweep;
+
+	// Row i of the reordered A is row m_permutation[i] of the original, empty without reordering.
+	std::vector<std::uint32_t> m_permutation;
+	std::size_t m_originalBandwidth {0};
+	std::size_t m_bandwidth {0};
+
+	// Single precision copies for the mixed-precision sweeps, of the values of A, of b - Ax, and
+	// the correction to x solved for.
+	std::vector<float> m_floatValues;
+	std::vector<float> m_floatResidual;
+	std::vector<float> m_floatCorrection;
+
+	// Set by Init A and Read b when their file could not be loaded. Separate flags since the two
+	// tasks may run concurrently.
+	bool m_failedToLoadA {false};
+	bool m_failedToLoadB {false};
+
+	int m_numIterations {0};
+	// Created by the first Init x, once the number of unknowns is known.
+	std::optional<TrajectoryRecorder> m_trajectory;
+
+	// Set by Init x when x was seeded from the cache. Its x has been moved into m_x.
+	std::optional<SolutionCache::WarmStart> m_warmStart;
+	std::uint64_t m_matrixFingerprint {0};
+
+	tf::Taskflow m_taskflow;
+};
+
+inline GaussSeidel::GaussSeidel(const Options& options)
+	: m_options(options)
+	, m_rng(options.seed != 0 ? options.seed : std::random_device {}())
+	, m_numUnknowns(options.matrix != nullptr ? options.matrix->numRows : options.numUnknowns)
+{
+	if (m_options.fusedSweeps > 0)
+		emplaceFusedTasks();
+	else
+		emplaceTasks();
+}
+
+inline void GaussSeidel::emplaceTasks()
+{
+	tf::Task initA = m_taskflow.emplace([this](tf::Subflow& subflow) { this->initA(subflow); });
+	tf::Task colorA = m_taskflow.emplace([this]() { this->colorA(); });
+	tf::Task initX = m_taskflow.emplace([this]() { this->initX(); });
+	tf::Task readB = m_taskflow.emplace([this](tf::Subflow& subflow) { this->readB(subflow); });
+	tf::Task computeResidual =
+		m_taskflow.emplace([this](tf::Subflow& subflow) { this->computeResidual(subflow); });
+	tf::Task recordTrajectory = m_taskflow.emplace([this]() { this->recordTrajectory(); });
+	tf::Task shouldLoop = m_taskflow.emplace([this]() { return this->shouldLoop(); });
+	tf::Task updateX =
+		m_taskflow.emplace([this](tf::Runtime& runtime) { return this->updateX(runtime); });
+	tf::Task printResult = m_taskflow.emplace([this]() { this->printResult(); });
+
+	initA.precede(colorA);
+	orderInitTasks(initA, initX, readB);
+	computeResidual.succeed(colorA, initX, readB);
+	computeResidual.precede(recordTrajectory);
+	recordTrajectory.precede(shouldLoop);
+	shouldLoop.precede(updateX, emplaceRestoreOrder(printResult));
+	updateX.precede(computeResidual);
+
+	m_taskflow.name(m_options.name);
+	initA.name("Init A");
+	colorA.name("Color A");
+	initX.name("Init x");
+	readB.name("Read b");
+	computeResidual.name("Compute Residual");
+	recordTrajectory.name("Record Trajectory");
+	shouldLoop.name("Should loop");
+	updateX.name("Update x");
+	printResult.name("Print result");
+}
+
+inline void GaussSeidel::emplaceFusedTasks()
+{
+	tf::Task initA = m_taskflow.emplace([this](tf::Subflow& subflow) { this->initA(subflow); });
+	tf::Task colorA = m_taskflow.emplace([this]() { this->colorA(); });
+	tf::Task initX = m_taskflow.emplace([this]() { this->initX(); });
+	tf::Task readB = m_taskflow.emplace([this](tf::Subflow& subflow) { this->readB(subflow); });
+	tf::Task sweepAndCheck = m_taskflow.emplace([this]() { this->sweepAndCheck(); });
+	tf::Task shouldLoop = m_taskflow.emplace([this]() { return this->shouldLoop(); });
+	tf::Task printResult = m_taskflow.emplace([this]() { this->printResult(); });
+
+	// Sweep and check is a static task with strong dependencies on the init tasks, which are only
+	// satisfied once, and a weak dependency on Should loop, which is what forms the loop.
+	initA.precede(colorA);
+	orderInitTasks(initA, initX, readB);
+	sweepAndCheck.succeed(colorA, initX, readB);
+	sweepAndCheck.precede(shouldLoop);
+	shouldLoop.precede(sweepAndCheck, emplaceRestoreOrder(printResult));
+
+	m_taskflow.name(m_options.name);
+	initA.name("Init A");
+	colorA.name("Color A");
+	initX.name("Init x");
+	readB.name("Read b");
+	sweepAndCheck.name("Sweep and check");
+	shouldLoop.name("Should loop");
+	printResult.name("Print result");
+}
+
+// Init x sizes everything after the number of unknowns, which a loaded A decides, checks that a
+// loaded b matches it, and looks up a warm start by A and b. Otherwise the init tasks are
+// independent.
+inline bool GaussSeidel::initXAfterReadB() const
+{
+	return m_options.rightHandSide == RightHandSide::File || m_options.warmStartCache != nullptr ||
+		   m_options.reorder;
+}
+
+inline void GaussSeidel::orderInitTasks(tf::Task initA, tf::Task initX, tf::Task readB) const
+{
+	const bool loadA = !m_options.matrixPath.empty();
+	const bool loadB = m_options.rightHandSide == RightHandSide::File;
+	if (loadA || m_options.warmStartCache != nullptr || m_options.reorder)
+		initA.precede(initX);
+	if (initXAfterReadB())
+		readB.precede(initX);
+	if (loadA && !loadB)
+		initA.precede(readB);
+}
+
+// The task Should loop exits to, Restore order in front of Print result when reordering.
+inline tf::Task GaussSeidel::emplaceRestoreOrder(tf::Task printResult)
+{
+	if (!m_options.reorder)
+		return printResult;
+	tf::Task restoreOrder = m_taskflow.emplace([this]() { this->restoreOrder(); });
+	restoreOrder.precede(printResult);
+	restoreOrder.name("Restore order");
+	return restoreOrder;
+}
+
+inline tf::Taskflow& GaussSeidel::taskflow()
+{
+	return m_taskflow;
+}
+
+inline double GaussSeidel::nextDouble()
+{
+	std::uniform_real_distribution<double> dist(0.0, 1.0);
+	return dist(m_rng);
+}
+
+inline void GaussSeidel::initA(tf::Subflow& subflow)
+{
+	if (m_options.matrix != nullptr)
+	{
+		m_A = *m_options.matrix;
+	}
+	else if (m_options.matrixPath.empty())
+	{
+		m_A = randomStencilMatrix(m_numUnknowns, [this]() { return nextDouble(); });
+	}
+	else
+	{
+		m_failedToLoadA = !loadMatrix(m_options.matrixPath, m_A, subflow, s_numLoadChunks);
+		if (m_failedToLoadA)
+			m_A = CsrMatrix {};
+		m_numUnknowns = m_A.numRows;
+	}
+	if (m_options.reorder)
+		reorderA();
+}
+
+inline void GaussSeidel::reorderA()
+{
+	m_originalBandwidth = bandwidth(m_A);
+	m_permutation = reverseCuthillMcKee(m_A);
+	m_A = permuteSymmetric(m_A, m_permutation);
+	m_bandwidth = bandwidth(m_A);
+}
+
+inline void GaussSeidel::colorA()
+{
+	m_coloring = colorRows(m_A);
+
+	m_sweep.clear();
+	if (m_options.mixedPrecisionSweeps > 0 && m_options.fusedSweeps == 0)
+	{
+		emplaceRefinementStep();
+		return;
+	}
+	tf::Task previous;
+	for (std::size_t color = 0; color < m_coloring.numColors(); ++color)
+	{
+		tf::Task updateColor = m_sweep.for_each_index(
+			m_coloring.colorBegin[color], m_coloring.colorBegin[color + 1], std::size_t {1},
+			[this](std::size_t i)
+			{ gaussSeidelRow(m_A, m_x.data(), m_b.data(), m_coloring.rows[i]); });
+		updateColor.name("Update color " + std::to_string(color));
+		if (!previous.empty())
+			previous.precede(updateColor);
+		previous = updateColor;
+	}
+}
+
+// Solve Ae = b - Ax approximately with mixedPrecisionSweeps single precision sweeps from e = 0,
+// then x += e in double precision. A single sweep gives the same iterate as a double precision
+// sweep would, apart from the rounding of e, and e shrinks along with the residual, so the residual
+// keeps converging far below single precision.
+inline void GaussSeidel::emplaceRefinementStep()
+{
+	m_floatValues.assign(m_A.values.begin(), m_A.values.end());
+	const std::size_t n = m_A.numRows;
+
+	// Compute Residual has left Ax - b in m_r.
+	tf::Task prepare = m_sweep.for_each_index(
+		std::size_t {0}, n, s_residualChunkSize,
+		[this, n](std::size_t begin)
+		{
+			const std::size_t end = std::min(begin + s_residualChunkSize, n);
+			for (std::size_t i = begin; i < end; ++i)
+			{
+				m_floatResidual[i] = float(-m_r[i]);
+				m_floatCorrection[i] = 0.0f;
+			}
+		});
+	prepare.name("Round residual");
+
+	tf::Task previous = prepare;
+	for (int sweep = 0; sweep < m_options.mixedPrecisionSweeps; ++sweep)
+	{
+		for (std::size_t color = 0; color < m_coloring.numColors(); ++color)
+		{
+			tf::Task updateColor = m_sweep.for_each_index(
+				m_coloring.colorBegin[color], m_coloring.colorBegin[color + 1], std::size_t {1},
+				[this](std::size_t i)
+				{
+					gaussSeidelRowFloat(
+						m_A, m_floatValues.data(), m_floatCorrection.data(),
+						m_floatResidual.data(), m_coloring.rows[i]);
+				});
+			updateColor.name(
+				"Sweep " + std::to_string(sweep) + " color " + std::to_string(color));
+			previous.precede(updateColor);
+			previous = updateColor;
+		}
+	}
+
+	tf::Task apply = m_sweep.for_each_index(
+		std::size_t {0}, n, s_residualChunkSize,
+		[this, n](std::size_t begin)
+		{
+			const std::size_t end = std::min(begin + s_residualChunkSize, n);
+			for (std::size_t i = begin; i < end; ++i)
+				m_x[i] += double(m_floatCorrection[i]);
+		});
+	apply.name("Apply correction");
+	previous.precede(apply);
+}
+
+inline void GaussSeidel::initX()
+{
+	const std::size_t n = m_numUnknowns;
+	// Otherwise Read b may still be running.
+	if (initXAfterReadB() && m_b.size() != n && !failed())
+	{
+		std::cerr << m_options.name << ": b has " << m_b.size() << " elements, expected " << n
+				  << ". Padding or truncating it.\n";
+		m_b.resize(n, 0.0);
+	}
+	// Only once, a second recorder would truncate the drain file of the first.
+	if (!m_trajectory)
+	{
+		TrajectoryRecorder::Options trajectoryOptions = m_options.trajectory;
+		trajectoryOptions.numElements = std::min(trajectoryOptions.numElements, n);
+		m_trajectory.emplace(trajectoryOptions);
+	}
+	m_x.assign(n, 0.0);
+	m_warmStart.reset();
+	if (m_options.warmStartCache != nullptr)
+	{
+		m_matrixFingerprint = matrixFingerprint(m_A);
+		m_warmStart = m_options.warmStartCache->lookup(m_matrixFingerprint, m_b);
+		if (m_warmStart)
+			m_x = std::move(m_warmStart->x);
+	}
+	// After the lookup, the cache holds b and x in the original order.
+	if (!m_permutation.empty())
+	{
+		permuteVector(m_b, m_permutation);
+		permuteVector(m_x, m_permutation);
+	}
+	m_r.assign(n, 0.0);
+	if (m_options.mixedPrecisionSweeps > 0)
+	{
+		m_floatResidual.assign(n, 0.0f);
+		m_floatCorrection.assign(n, 0.0f);
+	}
+	m_rChunkSums.assign((n + s_residualChunkSize - 1) / s_residualChunkSize, 0.0);
+	m_numIterations = 0;
+}
+
+inline void GaussSeidel::readB(tf::Subflow& subflow)
+{
+	if (m_options.rightHandSide == RightHandSide::File)
+	{
+		m_failedToLoadB = !loadVector(m_options.rightHandSidePath, m_b, subflow, s_numLoadChunks);
+		if (m_failedToLoadB)
+			m_b.clear();
+		return;
+	}
+	const std::size_t n = m_numUnknowns;
+	m_b.resize(n);
+	switch (m_options.rightHandSide)
+	{
+		case RightHandSide::Interactive:
+			if (n <= s_maxPrintedSize)
+			{
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					std::cout << "b[" << i << "]? ";
+					std::cin >> m_b[i];
+				}
+				break;
+			}
+			[[fallthrough]];
+		case RightHandSide::Alternating:
+			for (std::size_t i = 0; i < n; ++i)
+				m_b[i] = i % 2 == 0 ? 2.0 : 8.0;
+			break;
+		case RightHandSide::Random:
+		{
+			// Not nextDouble since Init A is using it concurrently.
+			std::mt19937 rng(m_options.seed != 0 ? m_options.seed + 1 : std::random_device {}());
+			std::uniform_real_distribution<double> dist(0.0, 1.0);
+			for (double& value : m_b)
+				value = dist(rng);
+			break;
+		}
+		case RightHandSide::Values:
+			m_b = m_options.rightHandSideValues;
+			break;
+		case RightHandSide::File:
+			break;
+	}
+}
+
+inline void GaussSeidel::computeResidual(tf::Subflow& subflow)
+{
+	const std::size_t n = m_numUnknowns;
+	subflow.for_each_index(
+		std::size_t {0}, n, s_residualChunkSize,
+		[this, n](std::size_t begin)
+		{
+			const std::size_t end = std::min(begin + s_residualChunkSize, n);
+			m_rChunkSums[begin / s_residualChunkSize] =
+				computeResidualRows(m_A, m_x.data(), m_b.data(), m_r.data(), begin, end);
+		});
+}
+
+inline void GaussSeidel::recordTrajectory()
+{
+	m_trajectory->record(std::uint64_t(m_numIterations), residualNorm(), m_x.data());
+}
+
+inline bool GaussSeidel::done() const
+{
+	return failed() || m_numIterations >= m_options.maxIterations || converged();
+}
+
+inline int GaussSeidel::shouldLoop()
+{
+	constexpr int loopAgain {0};
+	constexpr int exitLoop {1};
+	if (done())
+	{
+		return exitLoop;
+	}
+	else
+	{
+		return loopAgain;
+	}
+}
+
+// A condition task so that the edge back up to Compute Residual is a weak dependency, see the
+// Gauss-Seidel section in Taskflow.md. The sweep itself runs on all workers through the runtime.
+inline int GaussSeidel::updateX(tf::Runtime& runtime)
+{
+	runtime.corun(m_sweep);
+	++m_numIterations;
+	return 0;
+}
+
+inline void GaussSeidel::computeResidualSerial()
+{
+	const std::size_t n = m_numUnknowns;
+	for (std::size_t begin = 0; begin < n; begin += s_residualChunkSize)
+	{
+		const std::size_t end = std::min(begin + s_residualChunkSize, n);
+		m_rChunkSums[begin / s_residualChunkSize] =
+			computeResidualRows(m_A, m_x.data(), m_b.data(), m_r.data(), begin, end);
+	}
+}
+
+// Leaves the residual up to date with x when returning, so Should loop sees the same state as it
+// does after Record Trajectory in the unfused graph.
+inline void GaussSeidel::sweepAndCheck()
+{
+	if (m_numIterations == 0)
+	{
+		computeResidualSerial();
+		recordTrajectory();
+	}
+	for (int sweep = 0; sweep < m_options.fusedSweeps && !done(); ++sweep)
+	{
+		// The same row order as the parallel sweep, so both modes produce the same iterates.
+		for (std::uint32_t row : m_coloring.rows)
+			gaussSeidelRow(m_A, m_x.data(), m_b.data(), row);
+		++m_numIterations;
+		computeResidualSerial();
+		recordTrajectory();
+	}
+}
+
+inline void GaussSeidel::storeSolution()
+{
+	if (m_options.warmStartCache != nullptr)
+	{
+		m_options.warmStartCache->store(
+			m_matrixFingerprint, m_b, m_x, m_numIterations, !m_warmStart.has_value());
+	}
+}
+
+inline void GaussSeidel::restoreOrder()
+{
+	if (m_permutation.empty())
+		return;
+	unpermuteVector(m_x, m_permutation);
+	unpermuteVector(m_b, m_permutation);
+	unpermuteVector(m_r, m_permutation);
+}
+
+inline void GaussSeidel::printResult()
+{
+	storeSolution();
+	if (!m_options.printReport)
+		return;
+	// Built up front so that concurrent solvers don't interleave their reports.
+	std::ostringstream report;
+	writeReport(report);
+	bufferedCout() << report.str();
+}
+
+inline const std::string& GaussSeidel::name() const
+{
+	return m_options.name;
+}
+
+inline int GaussSeidel::numIterations() const
+{
+	return m_numIterations;
+}
+
+inline double GaussSeidel::residualNorm() const
+{
+	return std::sqrt(std::accumulate(m_rChunkSums.begin(), m_rChunkSums.end(), 0.0));
+}
+
+inline bool GaussSeidel::converged() const
+{
+	return !failed() && residualNorm() < m_options.tolerance;
+}
+
+inline bool GaussSeidel::failed() const
+{
+	return m_failedToLoadA || m_failedToLoadB;
+}
+
+inline const std::vector<double>& GaussSeidel::x() const
+{
+	return m_x;
+}
+
+inline bool GaussSeidel::warmStarted() const
+{
+	return m_warmStart.has_value();
+}
+
+inline std::optional<int> GaussSeidel::iterationsSaved() const
+{
+	if (!m_warmStart || !m_warmStart->coldIterations)
+		return std::nullopt;
+	return *m_warmStart->coldIterations - m_numIterations;
+}
+
+inline void GaussSeidel::writeReport(std::ostream& stream)
+{
+	const std::size_t n = m_numUnknowns;
+	auto out = [&stream](double v) -> const char*
+	{
+		stream << std::setw(7) << v;
+		return "";
+	};
+
+	stream << std::setprecision(4) << std::fixed << std::left << std::setfill('0');
+	stream << '\n';
+	stream << m_options.name << ":\n";
+	if (failed())
+	{
+		// The loader has said why on std::cerr.
+		stream << "Failed: could not load "
+			   << (m_failedToLoadA ? m_options.matrixPath : m_options.rightHandSidePath) << '\n';
+		return;
+	}
+	stream << "Unknowns: " << n << '\n';
+	stream << "Non-zeros: " << m_A.numNonZeros() << '\n';
+	stream << "Colors: " << m_coloring.numColors() << '\n';
+	if (!m_permutation.empty())
+	{
+		stream << "Bandwidth: " << m_originalBandwidth << ", " << m_bandwidth
+			   << " after reverse Cuthill-McKee\n";
+	}
+	stream << "Kernels: " << sparseKernels().name << '\n';
+	if (m_options.mixedPrecisionSweeps > 0 && m_options.fusedSweeps == 0)
+	{
+		stream << "Precision: mixed, " << m_options.mixedPrecisionSweeps
+			   << " single precision sweeps per refinement step\n";
+	}
+	if (n <= s_maxPrintedSize)
+	{
+		stream << '\n';
+		stream << "A:\n";
+		// A stays reordered, print it in the original order like x and b.
+		auto original = [this](std::size_t i)
+		{ return m_permutation.empty() ? i : std::size_t(m_permutation[i]); };
+		for (std::size_t row = 0; row < n; ++row)
+		{
+			std::vector<double> dense(n, 0.0);
+			for (std::size_t reordered = 0; reordered < n; ++reordered)
+			{
+				if (original(reordered) != row)
+					continue;
+				for (std::size_t k = m_A.rowBegin[reordered]; k < m_A.rowBegin[reordered + 1]; ++k)
+					dense[original(m_A.columns[k])] = m_A.values[k];
+			}
+			stream << "  |";
+			for (std::size_t column = 0; column < n; ++column)
+				stream << (column > 0 ? ", " : "") << out(dense[column]);
+			stream << "|\n";
+		}
+		stream << '\n';
+		stream << "x:\n";
+		for (std::size_t row = 0; row < n; ++row)
+			stream << "  |" << out(m_x[row]) << "|\n";
+		stream << '\n';
+		stream << "b:\n";
+		for (std::size_t row = 0; row < n; ++row)
+			stream << "  |" << out(m_b[row]) << "|\n";
+		stream << '\n';
+		stream << "Ax = b:\n";
+		for (std::size_t row = 0; row < n; ++row)
+			stream << "  |" << out(m_r[row] + m_b[row]) << "| = |" << out(m_b[row]) << "|\n";
+		stream << '\n';
+		stream << "Ax - b:\n";
+		for (std::size_t row = 0; row < n; ++row)
+			stream << "  |" << m_r[row] << "|\n";
+	}
+	stream << '\n';
+	stream << "Residual norm: " << std::scientific << residualNorm() << '\n';
+	stream << "Iterations: " << m_numIterations << '\n';
+	if (m_warmStart)
+	{
+		stream << "Warm start: |b - b'| = " << m_warmStart->distance;
+		if (const std::optional<int> saved = iterationsSaved())
+			stream << ", " << *saved << " iterations saved";
+		stream << '\n';
+	}
+	if (!m_trajectory->drainPath().empty())
+	{
+		m_trajectory->close();
+		if (!m_trajectory->drainFailed())
+		{
+			stream << "Trajectory written to " << m_trajectory->drainPath() << '\n';
+			return;
+		}
+		stream << "Trajectory could not be written to " << m_trajectory->drainPath() << '\n';
+	}
+	stream << "Trajectory: \n";
+	for (std::size_t sample = 0; sample < m_trajectory->numSamples(); ++sample)
+	{
+		const double* xSample = m_trajectory->x(sample);
+		stream << std::fixed << "  (";
+		for (std::size_t i = 0; i < m_trajectory->numElements(); ++i)
+			stream << (i > 0 ? ", " : "") << out(xSample[i]);
+		stream << "), |r| = " << std::scientific << m_trajectory->residualNorm(sample) << '\n';
+	}
+	if (m_trajectory->numDropped() > 0)
+		stream << "  ... " << m_trajectory->numDropped() << " more\n";
+}
@@ -0,0 +1,803 @@
+#pragma once
+
+// Project includes
+#include "sparse.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+#include "taskflow/algorithm/for_each.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// Platform includes.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Loaders for the A and b inputs of the solvers, from Matrix Market text files or from a compact
+// binary format. Files are memory mapped and parsed in parallel chunks by tasks emplaced into the
+// caller's subflow, so that a large input is spread over all workers instead of blocking one.
+//
+// Supported Matrix Market files:
+//   A: %%MatrixMarket matrix coordinate real|integer general|symmetric
+//   b: %%MatrixMarket matrix array real|integer general, with a single column.
+// A b file without a Matrix Market header is read as whitespace separated values.
+//
+// Binary files, all values native endian:
+//   A: char[8] "CSRBIN01", uint64 numRows, uint64 numNonZeros, uint64 rowBegin[numRows + 1],
+//      uint32 columns[numNonZeros], padding to a multiple of 8 bytes, double values[numNonZeros].
+//   b: char[8] "VECBIN01", uint64 size, double values[size].
+//
+// A is checked before it is returned: the solvers need the CSR arrays consistent, at most 2^31
+// rows, a nonzero diagonal and a structurally symmetric pattern, since the rows of one color are
+// swept concurrently and must not read each other's unknowns. A general Matrix Market file gets
+// explicit zeros for the missing mirror entries, so its pattern is that of A + A^T. A binary file
+// with an unsymmetric pattern is rejected.
+//
+// Errors are reported on std::cerr and signalled with a false return value.
+
+/// A read-only memory mapping of an entire file.
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::filesystem::path& path)
+	{
+		errno = 0;
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			std::cerr << "MappedFile: Could not open " << path << ": " << strerror(errno) << '\n';
+			return;
+		}
+		struct stat status {};
+		if (::fstat(fd, &status) != 0)
+		{
+			std::cerr << "MappedFile: Could not stat " << path << ": " << strerror(errno) << '\n';
+			::close(fd);
+			return;
+		}
+		m_size = std::size_t(status.st_size);
+		if (m_size > 0)
+		{
+			void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED)
+			{
+				std::cerr << "MappedFile: Could not map " << path << ": " << strerror(errno)
+						  << '\n';
+				m_size = 0;
+			}
+			else
+			{
+				m_data = static_cast<const char*>(data);
+				::madvise(data, m_size, MADV_SEQUENTIAL);
+			}
+		}
+		m_valid = m_size == 0 || m_data != nullptr;
+		::close(fd);
+	}
+
+	~MappedFile()
+	{
+		if (m_data != nullptr)
+			::munmap(const_cast<char*>(m_data), m_size);
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool valid() const
+	{
+		return m_valid;
+	}
+
+	std::string_view contents() const
+	{
+		return {m_data, m_size};
+	}
+
+private:
+	const char* m_data {nullptr};
+	std::size_t m_size {0};
+	bool m_valid {false};
+};
+
+namespace matrix_loader_detail
+{
+	// Chunks smaller than this are not worth a task of their own.
+	constexpr std::size_t s_minChunkSize {1 << 20};
+	// The vector kernels of sparse.h gather with signed 32-bit column indices.
+	constexpr std::uint64_t s_maxRows {std::uint64_t(std::numeric_limits<std::int32_t>::max())};
+	// Rows checked by one task of checkMatrix.
+	constexpr std::size_t s_checkChunkSize {1 << 14};
+
+	/// Split text into about numChunks pieces that each end just after a newline.
+	inline std::vector<std::string_view> splitLines(std::string_view text, std::size_t numChunks)
+	{
+		numChunks = std::max<std::size_t>(
+			1, std::min(numChunks, (text.size() + s_minChunkSize - 1) / s_minChunkSize));
+		std::vector<std::string_view> chunks;
+		std::size_t begin {0};
+		for (std::size_t chunk = 1; chunk <= numChunks && begin < text.size(); ++chunk)
+		{
+			std::size_t end = chunk == numChunks ? text.size() : text.size() * chunk / numChunks;
+			end = std::max(end, begin);
+			const std::size_t newline = text.find('\n', end);
+			end = newline == std::string_view::npos ? text.size() : newline + 1;
+			chunks.push_back(text.substr(begin, end - begin));
+			begin = end;
+		}
+		return chunks;
+	}
+
+	/// Pop the next line, without the newline, from text.
+	inline std::string_view nextLine(std::string_view& text)
+	{
+		const std::size_t newline = text.find('\n');
+		const std::string_view line = text.substr(0, newline);
+		text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+		return line;
+	}
+
+	inline bool isBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	/// Parse the next whitespace separated number from text. Returns false at end of text or on a
+	/// malformed number, which `malformed` tells apart.
+	template <typename T>
+	bool parseNext(std::string_view& text, T& value, bool& malformed)
+	{
+		std::size_t start {0};
+		while (start < text.size() && isBlank(text[start]))
+			++start;
+		text.remove_prefix(start);
+		if (text.empty())
+			return false;
+		// from_chars doesn't accept a leading plus sign.
+		if (text.front() == '+')
+			text.remove_prefix(1);
+		const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (error != std::errc {})
+		{
+			malformed = true;
+			return false;
+		}
+		text.remove_prefix(std::size_t(end - text.data()));
+		return true;
+	}
+
+	/// The Matrix Market banner and size line. `data` is the text after the size line.
+	struct MatrixMarketHeader
+	{
+		bool coordinate {false};
+		bool symmetric {false};
+		std::size_t numRows {0};
+		std::size_t numColumns {0};
+		std::size_t numEntries {0};
+		std::string_view data;
+	};
+
+	inline bool parseMatrixMarketHeader(
+		std::string_view text, const std::filesystem::path& path, MatrixMarketHeader& header)
+	{
+		auto fail = [&path](const char* what)
+		{
+			std::cerr << "matrix_loader: " << path << ": " << what << '\n';
+			return false;
+		};
+
+		std::string banner(nextLine(text));
+		std::transform(banner.begin(), banner.end(), banner.begin(),
+					   [](char c) { return char(std::tolower(c)); });
+		if (!banner.starts_with("%%matrixmarket matrix"))
+			return fail("Not a Matrix Market matrix.");
+		header.coordinate = banner.find(" coordinate") != std::string::npos;
+		header.symmetric = banner.find(" symmetric") != std::string::npos;
+		if (banner.find(" complex") != std::string::npos ||
+			banner.find(" pattern") != std::string::npos ||
+			banner.find(" skew-symmetric") != std::string::npos ||
+			banner.find(" hermitian") != std::string::npos)
+			return fail("Only real and integer general or symmetric matrices are supported.");
+
+		std::string_view sizeLine;
+		do
+		{
+			if (text.empty())
+				return fail("Missing size line.");
+			sizeLine = nextLine(text);
+		} while (sizeLine.empty() || sizeLine.front() == '%');
+
+		bool malformed {false};
+		if (!parseNext(sizeLine, header.numRows, malformed) ||
+			!parseNext(sizeLine, header.numColumns, malformed))
+			return fail("Malformed size line.");
+		if (header.coordinate && !parseNext(sizeLine, header.numEntries, malformed))
+			return fail("Malformed size line.");
+		if (!header.coordinate)
+			header.numEntries = header.numRows * header.numColumns;
+		header.data = text;
+		return true;
+	}
+
+	struct Triplet
+	{
+		std::uint32_t row;
+		std::uint32_t column;
+		double value;
+	};
+
+	/// Sort the entries of a row by column and sum the entries of repeated columns. Returns the
+	/// number of entries left, at the start of the row.
+	inline std::size_t sortRow(CsrMatrix& A, std::size_t row)
+	{
+		const std::size_t begin = A.rowBegin[row];
+		const std::size_t end = A.rowBegin[row + 1];
+		// Rows are short, insertion sort on the two parallel arrays.
+		for (std::size_t k = begin + 1; k < end; ++k)
+		{
+			const std::uint32_t column = A.columns[k];
+			const double value = A.values[k];
+			std::size_t j = k;
+			for (; j > begin && A.columns[j - 1] > column; --j)
+			{
+				A.columns[j] = A.columns[j - 1];
+				A.values[j] = A.values[j - 1];
+			}
+			A.columns[j] = column;
+			A.values[j] = value;
+		}
+		std::size_t last = begin;
+		for (std::size_t k = begin + 1; k < end; ++k)
+		{
+			if (A.columns[k] == A.columns[last])
+			{
+				A.values[last] += A.values[k];
+				continue;
+			}
+			++last;
+			A.columns[last] = A.columns[k];
+			A.values[last] = A.values[k];
+		}
+		return end > begin ? last + 1 - begin : 0;
+	}
+
+	/// Close the gaps sortRow left at the ends of rows, given the entries left in every row.
+	inline void compactRows(CsrMatrix& A, const std::vector<std::size_t>& rowSizes)
+	{
+		std::size_t next {0};
+		for (std::size_t row = 0; row < A.numRows; ++row)
+		{
+			const std::size_t begin = A.rowBegin[row];
+			// Entries only move towards the front, so nothing is overwritten before it is read.
+			for (std::size_t k = begin; k < begin + rowSizes[row]; ++k, ++next)
+			{
+				A.columns[next] = A.columns[k];
+				A.values[next] = A.values[k];
+			}
+			A.rowBegin[row] = next - rowSizes[row];
+		}
+		A.rowBegin[A.numRows] = next;
+		A.columns.resize(next);
+		A.values.resize(next);
+	}
+
+	/// Whether row `row` of A has an entry in column `column`. The columns of the row are sorted.
+	inline bool hasEntry(const CsrMatrix& A, std::size_t row, std::uint32_t column)
+	{
+		const auto begin = A.columns.begin() + std::ptrdiff_t(A.rowBegin[row]);
+		const auto end = A.columns.begin() + std::ptrdiff_t(A.rowBegin[row + 1]);
+		return std::binary_search(begin, end, column);
+	}
+
+	enum MatrixProblem : int
+	{
+		TooManyRows = 1,
+		BadRowOffsets = 2,
+		ColumnOutOfRange = 4,
+		ColumnsNotSorted = 8,
+		ZeroDiagonal = 16,
+		Unsymmetric = 32
+	};
+
+	/// Emplace tasks into `subflow` that check that A, of numRows rows once the tasks run, is
+	/// something the solvers can sweep, see the top of the file, and set the MatrixProblem bits
+	/// of what is wrong in `problems`. The row offsets are checked first and the rows then in
+	/// parallel chunks. Returns the first and the last task.
+	inline std::pair<tf::Task, tf::Task> emplaceMatrixChecks(
+		const CsrMatrix& A, std::size_t numRows, tf::Subflow& subflow, std::atomic<int>& problems)
+	{
+		tf::Task checkOffsets = subflow.emplace(
+			[&A, &problems]()
+			{
+				if (A.numRows > s_maxRows)
+					problems |= TooManyRows;
+				bool consistent = A.rowBegin.size() == A.numRows + 1 && A.rowBegin.front() == 0 &&
+								  A.rowBegin.back() == A.columns.size() &&
+								  A.columns.size() == A.values.size();
+				for (std::size_t row = 0; consistent && row < A.numRows; ++row)
+					consistent = A.rowBegin[row] <= A.rowBegin[row + 1];
+				if (!consistent)
+					problems |= BadRowOffsets;
+			});
+		tf::Task checkRows = subflow.for_each_index(
+			std::size_t {0}, numRows, s_checkChunkSize,
+			[&A, &problems](std::size_t first)
+			{
+				// The rows can't be walked with broken offsets.
+				if ((problems.load(std::memory_order_relaxed) & (TooManyRows | BadRowOffsets)) != 0)
+					return;
+				int found {0};
+				const std::size_t last = std::min<std::size_t>(first + s_checkChunkSize, A.numRows);
+				for (std::size_t row = first; row < last; ++row)
+				{
+					bool hasDiagonal {false};
+					for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+					{
+						const std::uint32_t column = A.columns[k];
+						if (column >= A.numRows)
+						{
+							found |= ColumnOutOfRange;
+							continue;
+						}
+						if (k > A.rowBegin[row] && A.columns[k - 1] >= column)
+							found |= ColumnsNotSorted;
+						if (column == row)
+							hasDiagonal = A.values[k] != 0.0;
+						else if (!hasEntry(A, column, std::uint32_t(row)))
+							found |= Unsymmetric;
+					}
+					if (!hasDiagonal)
+						found |= ZeroDiagonal;
+				}
+				if (found != 0)
+					problems.fetch_or(found, std::memory_order_relaxed);
+			});
+		checkOffsets.precede(checkRows);
+		checkOffsets.name("Check row offsets of A");
+		checkRows.name("Check rows of A");
+		return {checkOffsets, checkRows};
+	}
+
+	/// Report the first of the problems found by emplaceMatrixChecks, false if there are any.
+	inline bool reportMatrixProblems(int problems, const std::filesystem::path& path)
+	{
+		// The symmetry test searches sorted rows of valid columns, so those come first.
+		const char* what = (problems & TooManyRows) != 0      ? "More than 2^31 - 1 rows."
+						   : (problems & BadRowOffsets) != 0    ? "Inconsistent row offsets."
+						   : (problems & ColumnOutOfRange) != 0 ? "Column index out of range."
+						   : (problems & ColumnsNotSorted) != 0
+							   ? "Columns of a row are not sorted and unique."
+						   : (problems & ZeroDiagonal) != 0 ? "Missing or zero diagonal entry."
+						   : (problems & Unsymmetric) != 0
+							   ? "The pattern is not structurally symmetric."
+							   : nullptr;
+		if (what == nullptr)
+			return true;
+		std::cerr << "matrix_loader: " << path << ": " << what << '\n';
+		return false;
+	}
+
+	/// a * b + c, false if it doesn't fit in a size_t.
+	inline bool multiplyAdd(std::uint64_t a, std::uint64_t b, std::uint64_t c, std::size_t& result)
+	{
+		std::size_t product {0};
+		return !__builtin_mul_overflow(a, b, &product) &&
+			   !__builtin_add_overflow(product, c, &result);
+	}
+
+	template <typename T>
+	const T* binaryAt(std::string_view contents, std::size_t offset)
+	{
+		return reinterpret_cast<const T*>(contents.data() + offset);
+	}
+
+	inline bool loadBinaryMatrix(
+		std::string_view contents, const std::filesystem::path& path, CsrMatrix& A,
+		tf::Subflow& subflow)
+	{
+		constexpr std::size_t headerSize {8 + 2 * sizeof(std::uint64_t)};
+		if (contents.size() < headerSize)
+		{
+			std::cerr << "matrix_loader: " << path << ": Truncated header.\n";
+			return false;
+		}
+		const std::uint64_t numRows = *binaryAt<std::uint64_t>(contents, 8);
+		const std::uint64_t numNonZeros = *binaryAt<std::uint64_t>(contents, 16);
+		if (numRows > s_maxRows)
+		{
+			std::cerr << "matrix_loader: " << path << ": More than 2^31 - 1 rows.\n";
+			return false;
+		}
+		// The sizes come from the file, so every offset is checked for overflow before it is
+		// compared with the file size.
+		const std::size_t rowBeginOffset {headerSize};
+		std::size_t columnsOffset {0};
+		std::size_t columnsEnd {0};
+		std::size_t valuesEnd {0};
+		const bool fits =
+			multiplyAdd(numRows + 1, sizeof(std::uint64_t), rowBeginOffset, columnsOffset) &&
+			multiplyAdd(numNonZeros, sizeof(std::uint32_t), columnsOffset + 7, columnsEnd) &&
+			multiplyAdd(numNonZeros, sizeof(double), columnsEnd / 8 * 8, valuesEnd);
+		const std::size_t valuesOffset = columnsEnd / 8 * 8;
+		if (!fits || contents.size() < valuesEnd)
+		{
+			std::cerr << "matrix_loader: " << path << ": Truncated data.\n";
+			return false;
+		}
+
+		A.numRows = numRows;
+		A.rowBegin.resize(numRows + 1);
+		A.columns.resize(numNonZeros);
+		A.values.resize(numNonZeros);
+
+		// Copy in parallel chunks, which also spreads the page faults over the workers, then check.
+		std::atomic<int> problems {0};
+		const auto [firstCheck, lastCheck] = emplaceMatrixChecks(A, numRows, subflow, problems);
+		constexpr std::size_t chunkSize {1 << 18};
+		auto copyChunks = [&subflow, firstCheck](
+							  auto* destination, const auto* source, std::size_t count)
+		{
+			tf::Task copy = subflow.for_each_index(
+				std::size_t {0}, count, chunkSize,
+				[=](std::size_t begin)
+				{
+					const std::size_t end = std::min(begin + chunkSize, count);
+					std::memcpy(
+						destination + begin, source + begin, (end - begin) * sizeof(*source));
+				});
+			copy.precede(firstCheck);
+		};
+		copyChunks(
+			A.rowBegin.data(), binaryAt<std::uint64_t>(contents, rowBeginOffset), numRows + 1);
+		copyChunks(A.columns.data(), binaryAt<std::uint32_t>(contents, columnsOffset), numNonZeros);
+		copyChunks(A.values.data(), binaryAt<double>(contents, valuesOffset), numNonZeros);
+		subflow.join();
+		return reportMatrixProblems(problems.load(), path);
+	}
+
+	inline bool loadMatrixMarketMatrix(
+		std::string_view contents, const std::filesystem::path& path, CsrMatrix& A,
+		tf::Subflow& subflow, std::size_t numChunks)
+	{
+		MatrixMarketHeader header;
+		if (!parseMatrixMarketHeader(contents, path, header))
+			return false;
+		if (!header.coordinate || header.numRows != header.numColumns)
+		{
+			std::cerr << "matrix_loader: " << path << ": A must be a square coordinate matrix.\n";
+			return false;
+		}
+		if (header.numRows > s_maxRows)
+		{
+			std::cerr << "matrix_loader: " << path << ": More than 2^31 - 1 rows.\n";
+			return false;
+		}
+
+		const std::vector<std::string_view> chunks = splitLines(header.data, numChunks);
+		std::vector<std::vector<Triplet>> triplets(chunks.size());
+		std::atomic<bool> malformed {false};
+		bool countMismatch {false};
+
+		// Parse -> Assemble -> Sort rows -> Compact rows, all inside the caller's subflow.
+		tf::Task parse = subflow.for_each_index(
+			std::size_t {0}, chunks.size(), std::size_t {1},
+			[&](std::size_t chunk)
+			{
+				std::string_view text = chunks[chunk];
+				std::vector<Triplet>& out = triplets[chunk];
+				out.reserve(text.size() / 16);
+				bool bad {false};
+				while (!text.empty())
+				{
+					std::string_view line = nextLine(text);
+					if (line.empty() || line.front() == '%')
+						continue;
+					std::size_t row {};
+					std::size_t column {};
+					double value {};
+					if (!parseNext(line, row, bad) || !parseNext(line, column, bad) ||
+						!parseNext(line, value, bad))
+					{
+						bad = bad || line.find_first_not_of(" \t\r") != std::string_view::npos;
+						if (bad)
+							break;
+						continue;
+					}
+					if (row < 1 || row > header.numRows || column < 1 || column > header.numRows)
+					{
+						bad = true;
+						break;
+					}
+					// Matrix Market indices are one-based.
+					out.push_back({std::uint32_t(row - 1), std::uint32_t(column - 1), value});
+				}
+				if (bad)
+					malformed = true;
+			});
+
+		tf::Task assemble = subflow.emplace(
+			[&]()
+			{
+				std::size_t numEntries {0};
+				for (const std::vector<Triplet>& chunk : triplets)
+					numEntries += chunk.size();
+				if (numEntries != header.numEntries)
+					countMismatch = true;
+
+				// Every off-diagonal entry also goes to its mirror position, with its value if the
+				// file is symmetric and as an explicit zero otherwise, which Sort rows merges with
+				// the file's own entry there if it has one.
+				A.numRows = header.numRows;
+				A.rowBegin.assign(header.numRows + 1, 0);
+				for (const std::vector<Triplet>& chunk : triplets)
+				{
+					for (const Triplet& triplet : chunk)
+					{
+						++A.rowBegin[triplet.row + 1];
+						if (triplet.row != triplet.column)
+							++A.rowBegin[triplet.column + 1];
+					}
+				}
+				for (std::size_t row = 0; row < header.numRows; ++row)
+					A.rowBegin[row + 1] += A.rowBegin[row];
+				A.columns.resize(A.rowBegin.back());
+				A.values.resize(A.rowBegin.back());
+
+				std::vector<std::size_t> next(A.rowBegin.begin(), A.rowBegin.end() - 1);
+				auto insert = [&A, &next](std::uint32_t row, std::uint32_t column, double value)
+				{
+					const std::size_t k = next[row]++;
+					A.columns[k] = column;
+					A.values[k] = value;
+				};
+				for (std::vector<Triplet>& chunk : triplets)
+				{
+					for (const Triplet& triplet : chunk)
+					{
+						insert(triplet.row, triplet.column, triplet.value);
+						if (triplet.row != triplet.column)
+						{
+							insert(
+								triplet.column, triplet.row,
+								header.symmetric ? triplet.value : 0.0);
+						}
+					}
+					chunk = {};
+				}
+			});
+
+		std::vector<std::size_t> rowSizes(header.numRows);
+		tf::Task sortRows = subflow.for_each_index(
+			std::size_t {0}, header.numRows, std::size_t {1},
+			[&A, &rowSizes](std::size_t row) { rowSizes[row] = sortRow(A, row); });
+		tf::Task compact = subflow.emplace([&A, &rowSizes]() { compactRows(A, rowSizes); });
+		std::atomic<int> problems {0};
+		const tf::Task check = emplaceMatrixChecks(A, header.numRows, subflow, problems).first;
+
+		parse.precede(assemble);
+		assemble.precede(sortRows);
+		sortRows.precede(compact);
+		compact.precede(check);
+		parse.name("Parse A");
+		assemble.name("Assemble A");
+		sortRows.name("Sort rows of A");
+		compact.name("Compact rows of A");
+		subflow.join();
+
+		if (malformed)
+		{
+			std::cerr << "matrix_loader: " << path << ": Malformed entry.\n";
+			return false;
+		}
+		if (countMismatch)
+		{
+			std::cerr << "matrix_loader: " << path << ": Expected " << header.numEntries
+					  << " entries.\n";
+			return false;
+		}
+		// Checked last, a malformed or short file is reported as such rather than as a bad matrix.
+		return reportMatrixProblems(problems.load(), path);
+	}
+
+	inline bool loadBinaryVector(
+		std::string_view contents, const std::filesystem::path& path, std::vector<double>& v,
+		tf::Subflow& subflow)
+	{
+		constexpr std::size_t headerSize {8 + sizeof(std::uint64_t)};
+		const std::uint64_t size =
+			contents.size() >= headerSize ? *binaryAt<std::uint64_t>(contents, 8) : 0;
+		std::size_t end {0};
+		if (!multiplyAdd(size, sizeof(double), headerSize, end) || contents.size() < end)
+		{
+			std::cerr << "matrix_loader: " << path << ": Truncated file.\n";
+			return false;
+		}
+		v.resize(size);
+		constexpr std::size_t chunkSize {1 << 18};
+		const double* source = binaryAt<double>(contents, headerSize);
+		subflow.for_each_index(
+			std::size_t {0}, std::size_t(size), chunkSize,
+			[&v, source, size](std::size_t begin)
+			{
+				const std::size_t end = std::min<std::size_t>(begin + chunkSize, size);
+				std::memcpy(v.data() + begin, source + begin, (end - begin) * sizeof(double));
+			});
+		subflow.join();
+		return true;
+	}
+
+	inline bool loadTextVector(
+		std::string_view contents, const std::filesystem::path& path, std::vector<double>& v,
+		tf::Subflow& subflow, std::size_t numChunks)
+	{
+		std::size_t expectedSize {0};
+		bool sizeKnown {false};
+		if (contents.starts_with("%%"))
+		{
+			MatrixMarketHeader header;
+			if (!parseMatrixMarketHeader(contents, path, header))
+				return false;
+			if (header.coordinate || header.numColumns != 1)
+			{
+				std::cerr << "matrix_loader: " << path << ": b must be a single column array.\n";
+				return false;
+			}
+			expectedSize = header.numRows;
+			sizeKnown = true;
+			contents = header.data;
+		}
+
+		// Parse -> Offsets -> Gather. Each chunk parses into its own vector, which are then
+		// copied into place in parallel once the offsets are known.
+		const std::vector<std::string_view> chunks = splitLines(contents, numChunks);
+		std::vector<std::vector<double>> parsed(chunks.size());
+		std::vector<std::size_t> offsets(chunks.size() + 1, 0);
+		std::atomic<bool> malformed {false};
+
+		tf::Task parse = subflow.for_each_index(
+			std::size_t {0}, chunks.size(), std::size_t {1},
+			[&](std::size_t chunk)
+			{
+				std::string_view text = chunks[chunk];
+				std::vector<double>& out = parsed[chunk];
+				bool bad {false};
+				while (!text.empty())
+				{
+					std::string_view line = nextLine(text);
+					if (!line.empty() && line.front() == '%')
+						continue;
+					double value {};
+					while (parseNext(line, value, bad))
+						out.push_back(value);
+					if (bad)
+					{
+						malformed = true;
+						return;
+					}
+				}
+			});
+		tf::Task computeOffsets = subflow.emplace(
+			[&]()
+			{
+				for (std::size_t chunk = 0; chunk < chunks.size(); ++chunk)
+					offsets[chunk + 1] = offsets[chunk] + parsed[chunk].size();
+				v.resize(offsets.back());
+			});
+		tf::Task gather = subflow.for_each_index(
+			std::size_t {0}, chunks.size(), std::size_t {1},
+			[&](std::size_t chunk)
+			{ std::copy(parsed[chunk].begin(), parsed[chunk].end(), v.begin() + offsets[chunk]); });
+
+		parse.precede(computeOffsets);
+		computeOffsets.precede(gather);
+		parse.name("Parse b");
+		computeOffsets.name("Offsets of b");
+		gather.name("Gather b");
+		subflow.join();
+
+		if (malformed)
+		{
+			std::cerr << "matrix_loader: " << path << ": Malformed value.\n";
+			return false;
+		}
+		if (sizeKnown && v.size() != expectedSize)
+		{
+			std::cerr << "matrix_loader: " << path << ": Expected " << expectedSize
+					  << " values, found " << v.size() << ".\n";
+			return false;
+		}
+		return true;
+	}
+}
+
+/// Load A from a Matrix Market coordinate file or a binary CSR file, using tasks in `subflow`.
+/// Joins the subflow. The rows of the loaded matrix have their columns sorted and unique, and the
+/// matrix passed the checks at the top of the file.
+inline bool loadMatrix(
+	const std::filesystem::path& path, CsrMatrix& A, tf::Subflow& subflow, std::size_t numChunks)
+{
+	const MappedFile file(path);
+	if (!file.valid())
+		return false;
+	const std::string_view contents = file.contents();
+	if (contents.starts_with("CSRBIN01"))
+		return matrix_loader_detail::loadBinaryMatrix(contents, path, A, subflow);
+	return matrix_loader_detail::loadMatrixMarketMatrix(contents, path, A, subflow, numChunks);
+}
+
+/// Load b from a Matrix Market array file, a binary vector file, or a file of whitespace
+/// separated values, using tasks in `subflow`. Joins the subflow.
+inline bool loadVector(
+	const std::filesystem::path& path, std::vector<double>& v, tf::Subflow& subflow,
+	std::size_t numChunks)
+{
+	const MappedFile file(path);
+	if (!file.valid())
+		return false;
+	const std::string_view contents = file.contents();
+	if (contents.starts_with("VECBIN01"))
+		return matrix_loader_detail::loadBinaryVector(contents, path, v, subflow);
+	return matrix_loader_detail::loadTextVector(contents, path, v, subflow, numChunks);
+}
+
+/// Write A in the binary CSR format.
+inline bool writeBinaryMatrix(const std::filesystem::path& path, const CsrMatrix& A)
+{
+	errno = 0;
+	std::ofstream stream(path, std::ios_base::binary | std::ios_base::trunc);
+	if (!stream)
+	{
+		std::cerr << "matrix_loader: Could not open " << path << ": " << strerror(errno) << '\n';
+		return false;
+	}
+	auto write = [&stream](const auto* data, std::size_t count)
+	{ stream.write(reinterpret_cast<const char*>(data), std::streamsize(count * sizeof(*data))); };
+	const std::uint64_t numRows {A.numRows};
+	const std::uint64_t numNonZeros {A.numNonZeros()};
+	stream.write("CSRBIN01", 8);
+	write(&numRows, 1);
+	write(&numNonZeros, 1);
+	write(A.rowBegin.data(), A.rowBegin.size());
+	write(A.columns.data(), A.columns.size());
+	const char padding[8] {};
+	stream.write(padding, std::streamsize(A.columns.size() % 2 * sizeof(std::uint32_t)));
+	write(A.values.data(), A.values.size());
+	return bool(stream);
+}
+
+/// Write v in the binary vector format.
+inline bool writeBinaryVector(const std::filesystem::path& path, const std::vector<double>& v)
+{
+	errno = 0;
+	std::ofstream stream(path, std::ios_base::binary | std::ios_base::trunc);
+	if (!stream)
+	{
+		std::cerr << "matrix_loader: Could not open " << path << ": " << strerror(errno) << '\n';
+		return false;
+	}
+	const std::uint64_t size {v.size()};
+	stream.write("VECBIN01", 8);
+	stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	stream.write(
+		reinterpret_cast<const char*>(v.data()), std::streamsize(v.size() * sizeof(double)));
+	return bool(stream);
+}
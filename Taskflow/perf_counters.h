@@ -0,0 +1,345 @@
+#pragma once
+
+// Project includes
+#include "utils.h"
+
+// Taskflow includes.
+#include "taskflow/taskflow.hpp"
+
+// Standard library includes.
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Platform includes.
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf_counter_detail
+{
+	// Cycles, instructions, cache misses and branch misses, see PerfCounterObserver::Counter.
+	inline constexpr std::size_t NumCounters {4};
+
+	struct Sample
+	{
+		std::uint64_t nanoseconds {0};
+		// Time the counters were enabled and actually counting, which differ when multiplexed.
+		std::uint64_t enabled {0};
+		std::uint64_t running {0};
+		std::array<std::uint64_t, NumCounters> counts {};
+	};
+
+	struct Totals
+	{
+		Totals& operator+=(const Totals& other)
+		{
+			runs += other.runs;
+			nanoseconds += other.nanoseconds;
+			for (std::size_t counter = 0; counter < NumCounters; ++counter)
+				counts[counter] += other.counts[counter];
+			counted = counted || other.counted;
+			return *this;
+		}
+
+		std::size_t runs {0};
+		std::uint64_t nanoseconds {0};
+		std::array<double, NumCounters> counts {};
+		bool counted {false};
+	};
+
+	struct NamedTotals
+	{
+		// The task's name when it first ran.
+		std::string name;
+		Totals totals;
+	};
+
+	struct Worker
+	{
+		Worker()
+		{
+			descriptors.fill(-1);
+		}
+
+		Worker(const Worker&) = delete;
+		Worker& operator=(const Worker&) = delete;
+
+		~Worker()
+		{
+#if defined(__linux__)
+			for (int descriptor : descriptors)
+			{
+				if (descriptor >= 0)
+					::close(descriptor);
+			}
+#endif
+		}
+
+		// Opens the counters of the calling thread, which must be the worker's.
+		void open()
+		{
+			opened = true;
+#if defined(__linux__)
+			static constexpr std::array<std::uint64_t, NumCounters> configs {
+				PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+				PERF_COUNT_HW_BRANCH_MISSES};
+			for (std::size_t counter = 0; counter < NumCounters; ++counter)
+			{
+				perf_event_attr attributes;
+				std::memset(&attributes, 0, sizeof(attributes));
+				attributes.size = sizeof(attributes);
+				attributes.type = PERF_TYPE_HARDWARE;
+				attributes.config = configs[counter];
+				attributes.disabled = counter == 0;
+				attributes.exclude_kernel = 1;
+				attributes.exclude_hv = 1;
+				attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+										 PERF_FORMAT_TOTAL_TIME_RUNNING;
+				// This thread, on any CPU, in one group led by the cycles counter.
+				descriptors[counter] = int(::syscall(
+					SYS_perf_event_open, &attributes, 0, -1, counter == 0 ? -1 : descriptors[0],
+					0));
+				if (descriptors[counter] < 0)
+				{
+					error = errno;
+					return;
+				}
+			}
+			if (::ioctl(descriptors[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0)
+			{
+				error = errno;
+				return;
+			}
+			counting = true;
+#else
+			error = ENOSYS;
+#endif
+		}
+
+		Sample sample() const
+		{
+			Sample result;
+#if defined(__linux__)
+			if (counting)
+			{
+				// nr, time_enabled, time_running, then one value per counter.
+				std::array<std::uint64_t, 3 + NumCounters> values {};
+				if (::read(descriptors[0], values.data(), sizeof(values)) ==
+					ssize_t(sizeof(values)))
+				{
+					result.enabled = values[1];
+					result.running = values[2];
+					std::copy(values.begin() + 3, values.end(), result.counts.begin());
+				}
+			}
+#endif
+			result.nanoseconds = std::uint64_t(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch())
+					.count());
+			return result;
+		}
+
+		std::array<int, NumCounters> descriptors;
+		bool opened {false};
+		bool counting {false};
+		int error {0};
+		std::vector<Sample> stack;
+		// By tf::Task::hash_value, so that a run costs an integer lookup and not a hash of the
+		// name. Totals of a task whose node was reused for another task go to retired.
+		std::unordered_map<std::size_t, NamedTotals> totals;
+		std::vector<NamedTotals> retired;
+	};
+}
+
+/// Counts hardware events (cycles, instructions, last level cache misses and branch misses) of
+/// every task an executor runs, and sums them by task name.
+///
+/// Every worker opens its own group of perf_event_open counters for its thread the first time it
+/// runs a task, and reads the whole group with one read() when a task starts and when it ends.
+/// Counts of tasks that corun a graph or join a subflow include the tasks they run meanwhile.
+///
+/// Where the counters can't be opened, because the platform isn't Linux, the kernel doesn't allow
+/// it (see /proc/sys/kernel/perf_event_paranoid) or the machine is virtualized without a PMU, only
+/// the number of runs and the wall time of each task are counted, and the report says so.
+///
+/// Create it with tf::Executor::make_observer. Only call report while the executor is idle.
+class PerfCounterObserver : public PerWorkerObserver<perf_counter_detail::Worker>
+{
+public:
+	enum Counter : std::size_t
+	{
+		Cycles,
+		Instructions,
+		CacheMisses,
+		BranchMisses,
+		NumCounters
+	};
+	static_assert(NumCounters == perf_counter_detail::NumCounters);
+
+	/// Print the report to std::cout when destroyed, which is when the executor is, if
+	/// `reportOnDestruction`.
+	explicit PerfCounterObserver(bool reportOnDestruction = false)
+		: m_reportOnDestruction(reportOnDestruction)
+	{
+	}
+
+	~PerfCounterObserver() override
+	{
+		if (m_reportOnDestruction)
+			report(std::cout);
+	}
+
+	void on_entry(tf::WorkerView workerView, tf::TaskView) override
+	{
+		Worker& worker = this->worker(workerView);
+		if (!worker.opened)
+			worker.open();
+		worker.stack.push_back(worker.sample());
+	}
+
+	void on_exit(tf::WorkerView workerView, tf::TaskView taskView) override
+	{
+		Worker& worker = this->worker(workerView);
+		const Sample end = worker.sample();
+		const Sample begin = worker.stack.back();
+		worker.stack.pop_back();
+
+		const std::string& name = taskView.name();
+		perf_counter_detail::NamedTotals& named = worker.totals[taskView.hash_value()];
+		if (named.totals.runs == 0)
+			named.name = name;
+		else if (named.name != name)
+		{
+			// A subflow task freed since and its node given to another task, or a renamed task.
+			worker.retired.push_back(std::move(named));
+			named = {name, {}};
+		}
+		Totals& totals = named.totals;
+		++totals.runs;
+		totals.nanoseconds += end.nanoseconds - begin.nanoseconds;
+		if (!worker.counting)
+			return;
+		// When the kernel multiplexed the counters they only ran for part of the task, scale
+		// their counts up to the whole task.
+		const std::uint64_t enabled = end.enabled - begin.enabled;
+		const std::uint64_t running = end.running - begin.running;
+		const double scale = running > 0 && running < enabled ? double(enabled) / running : 1.0;
+		for (std::size_t counter = 0; counter < NumCounters; ++counter)
+			totals.counts[counter] += double(end.counts[counter] - begin.counts[counter]) * scale;
+		totals.counted = true;
+	}
+
+	/// Whether any worker could open its hardware counters.
+	bool counting() const
+	{
+		for (std::size_t index = 0; index < numWorkers(); ++index)
+		{
+			if (worker(index).counting)
+				return true;
+		}
+		return false;
+	}
+
+	/// Why the counters couldn't be opened.
+	std::string unavailableReason() const
+	{
+		for (std::size_t index = 0; index < numWorkers(); ++index)
+		{
+			if (worker(index).error != 0)
+				return std::string("perf_event_open: ") + strerror(worker(index).error);
+		}
+		return "no tasks ran";
+	}
+
+	/// One line per task name, the most cycles, or the most time without counters, first.
+	void report(std::ostream& stream) const
+	{
+		std::unordered_map<std::string, Totals> merged;
+		for (std::size_t index = 0; index < numWorkers(); ++index)
+		{
+			for (const auto& [task, named] : worker(index).totals)
+				merged[named.name] += named.totals;
+			for (const perf_counter_detail::NamedTotals& named : worker(index).retired)
+				merged[named.name] += named.totals;
+		}
+		std::vector<std::pair<std::string, Totals>> rows(merged.begin(), merged.end());
+		const bool withCounters = counting();
+		std::sort(
+			rows.begin(), rows.end(),
+			[withCounters](const auto& a, const auto& b)
+			{
+				if (withCounters)
+					return a.second.counts[Cycles] > b.second.counts[Cycles];
+				return a.second.nanoseconds > b.second.nanoseconds;
+			});
+
+		const std::ios_base::fmtflags flags = stream.flags();
+		const std::streamsize precision = stream.precision();
+		stream << '\n';
+		if (!withCounters)
+			stream << "Hardware counters unavailable, " << unavailableReason() << '\n';
+		stream << std::left << std::setw(32) << "Task" << std::right << std::setw(10) << "Runs"
+			   << std::setw(12) << "Time [ms]";
+		if (withCounters)
+		{
+			stream << std::setw(14) << "Cycles" << std::setw(14) << "Instructions" << std::setw(7)
+				   << "IPC" << std::setw(12) << "LLC misses" << std::setw(10) << "MPKI"
+				   << std::setw(14) << "Branch misses";
+		}
+		stream << '\n';
+		stream << std::fixed;
+		for (const auto& [name, totals] : rows)
+		{
+			const std::string shortName = name.empty() ? "(unnamed)" : name.substr(0, 31);
+			stream << std::left << std::setw(32) << shortName << std::right << std::setw(10)
+				   << totals.runs << std::setw(12) << std::setprecision(3)
+				   << double(totals.nanoseconds) / 1e6;
+			if (withCounters && totals.counted)
+			{
+				const double instructions = totals.counts[Instructions];
+				stream << std::setprecision(0) << std::setw(14) << totals.counts[Cycles]
+					   << std::setw(14) << instructions << std::setprecision(2) << std::setw(7)
+					   << (totals.counts[Cycles] > 0 ? instructions / totals.counts[Cycles] : 0.0)
+					   << std::setprecision(0) << std::setw(12) << totals.counts[CacheMisses]
+					   << std::setprecision(2) << std::setw(10)
+					   << (instructions > 0 ? totals.counts[CacheMisses] * 1e3 / instructions : 0.0)
+					   << std::setprecision(0) << std::setw(14) << totals.counts[BranchMisses];
+			}
+			stream << '\n';
+		}
+		stream.flags(flags);
+		stream.precision(precision);
+	}
+
+private:
+	using Sample = perf_counter_detail::Sample;
+	using Totals = perf_counter_detail::Totals;
+
+	bool m_reportOnDestruction;
+};
+
+/// Count hardware events of every task `executor` runs if the TASK_COUNTERS environment variable
+/// is set, printing the totals by task name when the executor is destroyed.
+inline void countIfRequested(tf::Executor& executor)
+{
+	const char* value = std::getenv("TASK_COUNTERS");
+	if (value != nullptr && *value != '\0')
+		executor.make_observer<PerfCounterObserver>(true);
+}
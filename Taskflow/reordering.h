@@ -0,0 +1,138 @@
+#pragma once
+
+// Project includes
+#include "sparse.h"
+
+// Standard library includes.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+/// The largest distance of a non-zero from the diagonal, max |i - j| over all A[i][j] != 0.
+inline std::size_t bandwidth(const CsrMatrix& A)
+{
+	std::size_t result {0};
+	for (std::size_t row = 0; row < A.numRows; ++row)
+	{
+		for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+		{
+			const std::size_t column = A.columns[k];
+			result = std::max(result, column > row ? column - row : row - column);
+		}
+	}
+	return result;
+}
+
+/// The reverse Cuthill-McKee ordering of the rows of a matrix with a structurally symmetric
+/// sparsity pattern. Row i of the reordered matrix is row permutation[i] of A.
+///
+/// Every connected component is traversed breadth first from a row of minimum degree, visiting
+/// the neighbors of each row in order of increasing degree, and the resulting order is reversed.
+/// Rows that reference each other end up close together, which keeps the part of x a sweep
+/// touches small enough to stay in cache.
+inline std::vector<std::uint32_t> reverseCuthillMcKee(const CsrMatrix& A)
+{
+	const std::size_t n = A.numRows;
+	auto degree = [&A](std::uint32_t row) { return A.rowBegin[row + 1] - A.rowBegin[row]; };
+
+	// Candidates for the start of each component, lowest degree first.
+	std::vector<std::uint32_t> byDegree(n);
+	for (std::size_t row = 0; row < n; ++row)
+		byDegree[row] = std::uint32_t(row);
+	std::stable_sort(
+		byDegree.begin(), byDegree.end(),
+		[&degree](std::uint32_t a, std::uint32_t b) { return degree(a) < degree(b); });
+
+	std::vector<std::uint32_t> order;
+	order.reserve(n);
+	std::vector<bool> visited(n, false);
+	std::vector<std::uint32_t> neighbors;
+	for (std::uint32_t start : byDegree)
+	{
+		if (visited[start])
+			continue;
+		visited[start] = true;
+		// order doubles as the queue, [head, order.size()) are yet to be expanded.
+		std::size_t head = order.size();
+		order.push_back(start);
+		for (; head < order.size(); ++head)
+		{
+			const std::uint32_t row = order[head];
+			neighbors.clear();
+			for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+			{
+				const std::uint32_t column = A.columns[k];
+				if (!visited[column])
+				{
+					visited[column] = true;
+					neighbors.push_back(column);
+				}
+			}
+			std::stable_sort(
+				neighbors.begin(), neighbors.end(),
+				[&degree](std::uint32_t a, std::uint32_t b) { return degree(a) < degree(b); });
+			order.insert(order.end(), neighbors.begin(), neighbors.end());
+		}
+	}
+	std::reverse(order.begin(), order.end());
+	return order;
+}
+
+/// PAP^T for the permutation matrix P that moves row permutation[i] of A to row i. Columns are
+/// renumbered to match and sorted within every row.
+inline CsrMatrix permuteSymmetric(const CsrMatrix& A, const std::vector<std::uint32_t>& permutation)
+{
+	const std::size_t n = A.numRows;
+	std::vector<std::uint32_t> inverse(n);
+	for (std::size_t i = 0; i < n; ++i)
+		inverse[permutation[i]] = std::uint32_t(i);
+
+	CsrMatrix B;
+	B.numRows = n;
+	B.rowBegin.reserve(n + 1);
+	B.columns.reserve(A.numNonZeros());
+	B.values.reserve(A.numNonZeros());
+	B.rowBegin.push_back(0);
+	for (std::size_t row = 0; row < n; ++row)
+	{
+		const std::size_t oldRow = permutation[row];
+		const std::size_t begin = B.values.size();
+		for (std::size_t k = A.rowBegin[oldRow]; k < A.rowBegin[oldRow + 1]; ++k)
+		{
+			// Insertion sort by new column, rows are short.
+			const std::uint32_t column = inverse[A.columns[k]];
+			std::size_t j = B.columns.size();
+			B.columns.push_back(column);
+			B.values.push_back(A.values[k]);
+			for (; j > begin && B.columns[j - 1] > column; --j)
+			{
+				std::swap(B.columns[j], B.columns[j - 1]);
+				std::swap(B.values[j], B.values[j - 1]);
+			}
+		}
+		B.rowBegin.push_back(B.values.size());
+	}
+	return B;
+}
+
+/// v[permutation[i]] moved to element i, for moving vectors into the order of permuteSymmetric.
+template <typename T>
+void permuteVector(std::vector<T>& v, const std::vector<std::uint32_t>& permutation)
+{
+	std::vector<T> permuted(v.size());
+	for (std::size_t i = 0; i < v.size(); ++i)
+		permuted[i] = v[permutation[i]];
+	v.swap(permuted);
+}
+
+/// The inverse of permuteVector, element i moved back to v[permutation[i]].
+template <typename T>
+void unpermuteVector(std::vector<T>& v, const std::vector<std::uint32_t>& permutation)
+{
+	std::vector<T> original(v.size());
+	for (std::size_t i = 0; i < v.size(); ++i)
+		original[permutation[i]] = v[i];
+	v.swap(original);
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+// Project includes
+#include "sparse.h"
+
+// Standard library includes.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/// A content hash of A, so that solves of the same matrix find each other's solutions no matter
+/// how the matrix was built or loaded.
+inline std::uint64_t matrixFingerprint(const CsrMatrix& A)
+{
+	// FNV-1a over the raw bytes of the three arrays.
+	std::uint64_t hash {14695981039346656037ull};
+	auto mix = [&hash](const void* data, std::size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	};
+	mix(&A.numRows, sizeof(A.numRows));
+	mix(A.rowBegin.data(), A.rowBegin.size() * sizeof(A.rowBegin[0]));
+	mix(A.columns.data(), A.columns.size() * sizeof(A.columns[0]));
+	mix(A.values.data(), A.values.size() * sizeof(A.values[0]));
+	return hash;
+}
+
+/// Solutions of previous solves, keyed by matrix, for warm-starting the next solve of the same
+/// matrix with a slightly different b.
+///
+/// Every matrix keeps its `solutionsPerMatrix` most recently stored (b, x) pairs, and at most
+/// `numMatrices` matrices are kept, the least recently used being evicted first. A lookup returns
+/// the x whose b is closest to the new b, since for Ax = b the change in x is bounded by the
+/// change in b.
+///
+/// The cache also remembers how many iterations the last solve of each matrix from x = 0 took,
+/// which is the baseline for the iterations a warm start saves.
+///
+/// All members may be called concurrently, so one cache can serve many solvers.
+class SolutionCache
+{
+public:
+	struct Options
+	{
+		std::size_t numMatrices {16};
+		std::size_t solutionsPerMatrix {4};
+	};
+
+	struct WarmStart
+	{
+		std::vector<double> x;
+		// The distance between the new b and the b that x solves.
+		double distance;
+		// Iterations of the last cold solve of the matrix, if there was one.
+		std::optional<int> coldIterations;
+	};
+
+	SolutionCache() = default;
+
+	explicit SolutionCache(const Options& options)
+		: m_options(options)
+	{
+	}
+
+	SolutionCache(const SolutionCache&) = delete;
+	SolutionCache& operator=(const SolutionCache&) = delete;
+
+	/// The stored x whose b is closest to `b`, if any solution of the matrix is cached.
+	std::optional<WarmStart> lookup(std::uint64_t matrix, const std::vector<double>& b)
+	{
+		const std::lock_guard lock(m_mutex);
+		const auto found = m_entries.find(matrix);
+		if (found == m_entries.end())
+			return std::nullopt;
+		m_recentlyUsed.splice(m_recentlyUsed.begin(), m_recentlyUsed, found->second.recentlyUsed);
+
+		const Entry& entry = found->second;
+		const Solution* closest {nullptr};
+		double closestDistanceSquared {std::numeric_limits<double>::max()};
+		for (const Solution& solution : entry.solutions)
+		{
+			if (solution.b.size() != b.size())
+				continue;
+			double distanceSquared {0.0};
+			for (std::size_t i = 0; i < b.size(); ++i)
+				distanceSquared += (b[i] - solution.b[i]) * (b[i] - solution.b[i]);
+			if (distanceSquared < closestDistanceSquared)
+			{
+				closestDistanceSquared = distanceSquared;
+				closest = &solution;
+			}
+		}
+		if (closest == nullptr)
+			return std::nullopt;
+		return WarmStart {closest->x, std::sqrt(closestDistanceSquared), entry.coldIterations};
+	}
+
+	/// Store the solution x of Ax = b. `cold` tells whether the solve started from x = 0, in which
+	/// case `iterations` becomes the matrix's baseline.
+	void store(
+		std::uint64_t matrix, const std::vector<double>& b, const std::vector<double>& x,
+		int iterations, bool cold)
+	{
+		const std::lock_guard lock(m_mutex);
+		auto found = m_entries.find(matrix);
+		if (found == m_entries.end())
+		{
+			if (m_options.numMatrices == 0)
+				return;
+			if (m_entries.size() >= m_options.numMatrices)
+			{
+				m_entries.erase(m_recentlyUsed.back());
+				m_recentlyUsed.pop_back();
+			}
+			m_recentlyUsed.push_front(matrix);
+			found = m_entries.emplace(matrix, Entry {{}, {}, m_recentlyUsed.begin()}).first;
+		}
+		else
+		{
+			m_recentlyUsed.splice(
+				m_recentlyUsed.begin(), m_recentlyUsed, found->second.recentlyUsed);
+		}
+
+		Entry& entry = found->second;
+		if (cold)
+			entry.coldIterations = iterations;
+		if (m_options.solutionsPerMatrix == 0)
+			return;
+		if (entry.solutions.size() >= m_options.solutionsPerMatrix)
+			entry.solutions.erase(entry.solutions.begin());
+		entry.solutions.push_back({b, x});
+	}
+
+private:
+	struct Solution
+	{
+		std::vector<double> b;
+		std::vector<double> x;
+	};
+
+	struct Entry
+	{
+		// Oldest first.
+		std::vector<Solution> solutions;
+		std::optional<int> coldIterations;
+		std::list<std::uint64_t>::iterator recentlyUsed;
+	};
+
+	Options m_options {};
+	std::mutex m_mutex;
+	std::unordered_map<std::uint64_t, Entry> m_entries;
+	// Matrix keys, most recently used first.
+	std::list<std::uint64_t> m_recentlyUsed;
+};
@@ -0,0 +1,488 @@
+#pragma once
+
+// Standard library includes.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+// Platform includes.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SPARSE_HAS_X86_KERNELS 1
+#else
+#define SPARSE_HAS_X86_KERNELS 0
+#endif
+
+/// A square sparse matrix in Compressed Sparse Row format.
+///
+/// The column indices and values of row i are stored in the half-open range
+/// [rowBegin[i], rowBegin[i + 1]) of columns and values. Column indices are 32-bit to halve the
+/// index bandwidth of the sweeps, which limits the matrix to 2^31 rows.
+struct CsrMatrix
+{
+	std::size_t numRows {0};
+	std::vector<std::size_t> rowBegin;
+	std::vector<std::uint32_t> columns;
+	std::vector<double> values;
+
+	std::size_t numNonZeros() const
+	{
+		return values.size();
+	}
+
+	double diagonal(std::size_t row) const
+	{
+		for (std::size_t k = rowBegin[row]; k < rowBegin[row + 1]; ++k)
+		{
+			if (columns[k] == row)
+				return values[k];
+		}
+		return 0.0;
+	}
+};
+
+/// A random matrix with a 2D five-point stencil-like pattern, with the grid rows wrapped into a
+/// single index range. The pattern is structurally symmetric, which the coloring requires, but the
+/// values are not. The matrix is strictly diagonally dominant, so Gauss-Seidel converges. For
+/// numRows = 2 this is a dense 2x2 matrix.
+///
+/// `next` is called for every random value and should return values in [0, 1).
+template <typename Random>
+CsrMatrix randomStencilMatrix(std::size_t numRows, Random&& next)
+{
+	const std::size_t stride =
+		std::max<std::size_t>(2, static_cast<std::size_t>(std::ceil(std::sqrt(double(numRows)))));
+	const std::ptrdiff_t offsets[] {-std::ptrdiff_t(stride), -1, 0, 1, std::ptrdiff_t(stride)};
+
+	CsrMatrix A;
+	A.numRows = numRows;
+	A.rowBegin.reserve(numRows + 1);
+	A.columns.reserve(std::size(offsets) * numRows);
+	A.values.reserve(std::size(offsets) * numRows);
+	A.rowBegin.push_back(0);
+	for (std::size_t row = 0; row < numRows; ++row)
+	{
+		std::size_t diagonalIndex {};
+		double offDiagonalSum {0.0};
+		for (std::ptrdiff_t offset : offsets)
+		{
+			const std::ptrdiff_t column = std::ptrdiff_t(row) + offset;
+			if (column < 0 || column >= std::ptrdiff_t(numRows))
+				continue;
+			double value {0.0};
+			if (offset == 0)
+			{
+				diagonalIndex = A.values.size();
+			}
+			else
+			{
+				value = next();
+				offDiagonalSum += value;
+			}
+			A.columns.push_back(static_cast<std::uint32_t>(column));
+			A.values.push_back(value);
+		}
+		// Make diagonal larger to get a better condition number.
+		A.values[diagonalIndex] = offDiagonalSum + next() + next();
+		A.rowBegin.push_back(A.values.size());
+	}
+	return A;
+}
+
+/// A random symmetric positive definite matrix with the pattern of randomStencilMatrix, for the
+/// conjugate gradient solver. The off-diagonal values are negative, as in a discretized Laplacian,
+/// and every diagonal exceeds the sum of the magnitudes of the off-diagonals of its row by
+/// `diagonalShift`. The smallest eigenvalue is therefore at least diagonalShift, and the smaller
+/// the shift the worse the condition number, and the slower Gauss-Seidel converges.
+///
+/// `next` is called for every random value and should return values in [0, 1).
+template <typename Random>
+CsrMatrix randomSymmetricStencilMatrix(std::size_t numRows, double diagonalShift, Random&& next)
+{
+	CsrMatrix A = randomStencilMatrix(numRows, next);
+
+	// Draw the upper triangle and mirror it into the lower one.
+	for (std::size_t row = 0; row < numRows; ++row)
+	{
+		for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+		{
+			const std::uint32_t column = A.columns[k];
+			if (column <= row)
+				continue;
+			A.values[k] = -next();
+			for (std::size_t kt = A.rowBegin[column]; kt < A.rowBegin[column + 1]; ++kt)
+			{
+				if (A.columns[kt] == row)
+					A.values[kt] = A.values[k];
+			}
+		}
+	}
+	for (std::size_t row = 0; row < numRows; ++row)
+	{
+		std::size_t diagonalIndex {};
+		double offDiagonalSum {0.0};
+		for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+		{
+			if (A.columns[k] == row)
+				diagonalIndex = k;
+			else
+				offDiagonalSum -= A.values[k];
+		}
+		A.values[diagonalIndex] = offDiagonalSum + diagonalShift;
+	}
+	return A;
+}
+
+/// A partitioning of the rows of a matrix into colors such that no two rows with the same color
+/// reference each other. All rows of a color can therefore be updated in parallel by a
+/// Gauss-Seidel sweep.
+///
+/// The rows of color c are rows[colorBegin[c]] to rows[colorBegin[c + 1] - 1].
+struct RowColoring
+{
+	std::vector<std::uint32_t> rows;
+	std::vector<std::size_t> colorBegin;
+
+	std::size_t numColors() const
+	{
+		return colorBegin.empty() ? 0 : colorBegin.size() - 1;
+	}
+};
+
+/// Greedy graph coloring of the rows of a matrix with a structurally symmetric sparsity pattern,
+/// i.e. A[i][j] != 0 if and only if A[j][i] != 0. For a non-symmetric pattern two rows may end up
+/// with the same color even though one of them references the other.
+inline RowColoring colorRows(const CsrMatrix& A)
+{
+	constexpr std::uint32_t uncolored {~std::uint32_t {0}};
+	std::vector<std::uint32_t> colorOf(A.numRows, uncolored);
+	// Marks which colors are taken by the neighbors of the current row. Storing the row index
+	// instead of a flag means the vector never has to be cleared between rows.
+	std::vector<std::size_t> takenBy;
+	std::uint32_t numColors {0};
+
+	for (std::size_t row = 0; row < A.numRows; ++row)
+	{
+		for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+		{
+			const std::uint32_t neighborColor = colorOf[A.columns[k]];
+			if (neighborColor != uncolored)
+				takenBy[neighborColor] = row;
+		}
+		std::uint32_t color {0};
+		while (color < numColors && takenBy[color] == row)
+			++color;
+		if (color == numColors)
+		{
+			++numColors;
+			takenBy.push_back(A.numRows);
+		}
+		colorOf[row] = color;
+	}
+
+	// Counting sort of the rows by color, rows keep their relative order within a color.
+	RowColoring coloring;
+	coloring.colorBegin.assign(numColors + 1, 0);
+	for (std::uint32_t color : colorOf)
+		++coloring.colorBegin[color + 1];
+	for (std::uint32_t color = 0; color < numColors; ++color)
+		coloring.colorBegin[color + 1] += coloring.colorBegin[color];
+	coloring.rows.resize(A.numRows);
+	std::vector<std::size_t> next(coloring.colorBegin.begin(), coloring.colorBegin.end() - 1);
+	for (std::size_t row = 0; row < A.numRows; ++row)
+		coloring.rows[next[colorOf[row]]++] = static_cast<std::uint32_t>(row);
+	return coloring;
+}
+
+// The residual and norm kernels come in a scalar version and, on x86-64, AVX2 and AVX-512
+// versions. The vector versions are compiled with target attributes so the rest of the program
+// does not need to be built for those instruction sets, and the version to use is picked at
+// runtime from the CPU features, see sparseKernels.
+
+/// Compute r = Ax - b for the rows in [begin, end).
+inline void computeResidualRowsScalar(
+	const CsrMatrix& A, const double* x, const double* b, double* r, std::size_t begin,
+	std::size_t end)
+{
+	for (std::size_t row = begin; row < end; ++row)
+	{
+		double Ax {0.0};
+		for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+			Ax += A.values[k] * x[A.columns[k]];
+		r[row] = Ax - b[row];
+	}
+}
+
+/// Sum of the squares of the n elements in v.
+inline double sumOfSquaresScalar(const double* v, std::size_t n)
+{
+	double sum {0.0};
+	for (std::size_t i = 0; i < n; ++i)
+		sum += v[i] * v[i];
+	return sum;
+}
+
+#if SPARSE_HAS_X86_KERNELS
+
+__attribute__((target("avx2,fma"))) inline double horizontalSumAvx2(__m256d v)
+{
+	const __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+// Four non-zeros per step, x is gathered through the 32-bit column indices.
+__attribute__((target("avx2,fma"))) inline void computeResidualRowsAvx2(
+	const CsrMatrix& A, const double* x, const double* b, double* r, std::size_t begin,
+	std::size_t end)
+{
+	const double* values = A.values.data();
+	const std::uint32_t* columns = A.columns.data();
+	for (std::size_t row = begin; row < end; ++row)
+	{
+		std::size_t k = A.rowBegin[row];
+		const std::size_t rowEnd = A.rowBegin[row + 1];
+		__m256d Ax = _mm256_setzero_pd();
+		for (; k + 4 <= rowEnd; k += 4)
+		{
+			const __m128i indices =
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(columns + k));
+			const __m256d xs = _mm256_i32gather_pd(x, indices, sizeof(double));
+			Ax = _mm256_fmadd_pd(_mm256_loadu_pd(values + k), xs, Ax);
+		}
+		double sum = horizontalSumAvx2(Ax);
+		for (; k < rowEnd; ++k)
+			sum += values[k] * x[columns[k]];
+		r[row] = sum - b[row];
+	}
+}
+
+// Two independent accumulators to hide the latency of the FMA chain.
+__attribute__((target("avx2,fma"))) inline double sumOfSquaresAvx2(const double* v, std::size_t n)
+{
+	__m256d sum0 = _mm256_setzero_pd();
+	__m256d sum1 = _mm256_setzero_pd();
+	std::size_t i {0};
+	for (; i + 8 <= n; i += 8)
+	{
+		const __m256d v0 = _mm256_loadu_pd(v + i);
+		const __m256d v1 = _mm256_loadu_pd(v + i + 4);
+		sum0 = _mm256_fmadd_pd(v0, v0, sum0);
+		sum1 = _mm256_fmadd_pd(v1, v1, sum1);
+	}
+	double sum = horizontalSumAvx2(_mm256_add_pd(sum0, sum1));
+	for (; i < n; ++i)
+		sum += v[i] * v[i];
+	return sum;
+}
+
+// Eight non-zeros per step. The tail of each row is handled with a masked load and gather, so
+// short rows, such as those of a stencil matrix, need no scalar remainder loop.
+__attribute__((target("avx512f"))) inline void computeResidualRowsAvx512(
+	const CsrMatrix& A, const double* x, const double* b, double* r, std::size_t begin,
+	std::size_t end)
+{
+	const double* values = A.values.data();
+	const std::uint32_t* columns = A.columns.data();
+	for (std::size_t row = begin; row < end; ++row)
+	{
+		std::size_t k = A.rowBegin[row];
+		const std::size_t rowEnd = A.rowBegin[row + 1];
+		__m512d Ax = _mm512_setzero_pd();
+		for (; k + 8 <= rowEnd; k += 8)
+		{
+			const __m256i indices =
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(columns + k));
+			const __m512d xs = _mm512_i32gather_pd(indices, x, sizeof(double));
+			Ax = _mm512_fmadd_pd(_mm512_loadu_pd(values + k), xs, Ax);
+		}
+		if (k < rowEnd)
+		{
+			const __mmask8 mask = static_cast<__mmask8>((1u << (rowEnd - k)) - 1u);
+			const __m256i indices =
+				_mm512_castsi512_si256(_mm512_maskz_loadu_epi32(__mmask16 {mask}, columns + k));
+			const __m512d xs =
+				_mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, indices, x, sizeof(double));
+			Ax = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, values + k), xs, Ax);
+		}
+		r[row] = _mm512_reduce_add_pd(Ax) - b[row];
+	}
+}
+
+__attribute__((target("avx512f"))) inline double sumOfSquaresAvx512(const double* v, std::size_t n)
+{
+	__m512d sum0 = _mm512_setzero_pd();
+	__m512d sum1 = _mm512_setzero_pd();
+	std::size_t i {0};
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m512d v0 = _mm512_loadu_pd(v + i);
+		const __m512d v1 = _mm512_loadu_pd(v + i + 8);
+		sum0 = _mm512_fmadd_pd(v0, v0, sum0);
+		sum1 = _mm512_fmadd_pd(v1, v1, sum1);
+	}
+	for (; i < n; i += 8)
+	{
+		const __mmask8 mask =
+			n - i >= 8 ? __mmask8 {0xff} : static_cast<__mmask8>((1u << (n - i)) - 1u);
+		const __m512d v0 = _mm512_maskz_loadu_pd(mask, v + i);
+		sum0 = _mm512_fmadd_pd(v0, v0, sum0);
+	}
+	return _mm512_reduce_add_pd(_mm512_add_pd(sum0, sum1));
+}
+
+#endif
+
+/// The residual and norm kernels selected for the current CPU.
+struct SparseKernels
+{
+	const char* name;
+	void (*computeResidualRows)(
+		const CsrMatrix& A, const double* x, const double* b, double* r, std::size_t begin,
+		std::size_t end);
+	double (*sumOfSquares)(const double* v, std::size_t n);
+};
+
+/// Pick the widest kernels the CPU supports. The SPARSE_KERNELS environment variable can be set to
+/// scalar, avx2, or avx512 to force a narrower version, for comparisons.
+inline SparseKernels selectSparseKernels()
+{
+	const SparseKernels scalar {"scalar", computeResidualRowsScalar, sumOfSquaresScalar};
+	const char* forced = std::getenv("SPARSE_KERNELS");
+	const std::string_view wanted = forced != nullptr ? forced : "avx512";
+	if (wanted == "scalar")
+		return scalar;
+#if SPARSE_HAS_X86_KERNELS
+	__builtin_cpu_init();
+	const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	const bool hasAvx512 = __builtin_cpu_supports("avx512f");
+	if (wanted == "avx512" && hasAvx512)
+		return {"avx512", computeResidualRowsAvx512, sumOfSquaresAvx512};
+	if (hasAvx2)
+		return {"avx2", computeResidualRowsAvx2, sumOfSquaresAvx2};
+#endif
+	return scalar;
+}
+
+inline const SparseKernels& sparseKernels()
+{
+	static const SparseKernels kernels = selectSparseKernels();
+	return kernels;
+}
+
+/// Compute r = Ax - b for the rows in [begin, end) and return the sum of squares of those
+/// residual elements, for use in a chunked norm reduction.
+inline double computeResidualRows(
+	const CsrMatrix& A, const double* x, const double* b, double* r, std::size_t begin,
+	std::size_t end)
+{
+	const SparseKernels& kernels = sparseKernels();
+	kernels.computeResidualRows(A, x, b, r, begin, end);
+	return kernels.sumOfSquares(r + begin, end - begin);
+}
+
+/// Compute y = Ax for the rows in [begin, end).
+inline void multiplyRows(
+	const CsrMatrix& A, const double* x, double* y, std::size_t begin, std::size_t end)
+{
+	for (std::size_t row = begin; row < end; ++row)
+	{
+		double sum {0.0};
+		for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+			sum += A.values[k] * x[A.columns[k]];
+		y[row] = sum;
+	}
+}
+
+/// Solve row `row` of Ax = b for x[row] given the current values of all other elements of x.
+inline void gaussSeidelRow(const CsrMatrix& A, double* x, const double* b, std::size_t row)
+{
+	double sum {b[row]};
+	double diagonal {0.0};
+	for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+	{
+		const std::uint32_t column = A.columns[k];
+		if (column == row)
+			diagonal = A.values[k];
+		else
+			sum -= A.values[k] * x[column];
+	}
+	x[row] = sum / diagonal;
+}
+
+/// gaussSeidelRow in single precision, for the inner sweeps of mixed-precision iterative
+/// refinement. `values` are the values of A rounded to float, the indices are A's.
+inline void gaussSeidelRowFloat(
+	const CsrMatrix& A, const float* values, float* x, const float* b, std::size_t row)
+{
+	float sum {b[row]};
+	float diagonal {0.0f};
+	for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+	{
+		const std::uint32_t column = A.columns[k];
+		if (column == row)
+			diagonal = values[k];
+		else
+			sum -= values[k] * x[column];
+	}
+	x[row] = sum / diagonal;
+}
+
+// Batched kernels for solving Ax = b for many right-hand sides at once. The vectors are stored
+// interleaved, element i of right-hand side l is at index i * numLanes + l, so every non-zero of A
+// is loaded once and applied to all lanes with contiguous, vectorizable, loads and stores.
+
+/// Compute R = AX - B for the rows in [begin, end) and add the sum of squares of the residual
+/// elements of each lane to laneSums[lane].
+inline void computeResidualRowsBatched(
+	const CsrMatrix& A, const double* X, const double* B, double* R, std::size_t numLanes,
+	std::size_t begin, std::size_t end, double* laneSums)
+{
+	for (std::size_t row = begin; row < end; ++row)
+	{
+		double* r = R + row * numLanes;
+		const double* b = B + row * numLanes;
+		for (std::size_t lane = 0; lane < numLanes; ++lane)
+			r[lane] = -b[lane];
+		for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+		{
+			const double value = A.values[k];
+			const double* x = X + std::size_t {A.columns[k]} * numLanes;
+			for (std::size_t lane = 0; lane < numLanes; ++lane)
+				r[lane] += value * x[lane];
+		}
+		for (std::size_t lane = 0; lane < numLanes; ++lane)
+			laneSums[lane] += r[lane] * r[lane];
+	}
+}
+
+/// Solve row `row` of AX = B for all lanes of X[row] given the current values of all other rows.
+inline void gaussSeidelRowBatched(
+	const CsrMatrix& A, double* X, const double* B, std::size_t numLanes, std::size_t row)
+{
+	// X[row] is not read by this row's own update, so it doubles as the accumulator.
+	double* x = X + row * numLanes;
+	const double* b = B + row * numLanes;
+	for (std::size_t lane = 0; lane < numLanes; ++lane)
+		x[lane] = b[lane];
+	double diagonal {0.0};
+	for (std::size_t k = A.rowBegin[row]; k < A.rowBegin[row + 1]; ++k)
+	{
+		const std::uint32_t column = A.columns[k];
+		if (column == row)
+		{
+			diagonal = A.values[k];
+			continue;
+		}
+		const double value = A.values[k];
+		const double* neighbor = X + std::size_t {column} * numLanes;
+		for (std::size_t lane = 0; lane < numLanes; ++lane)
+			x[lane] -= value * neighbor[lane];
+	}
+	const double inverseDiagonal = 1.0 / diagonal;
+	for (std::size_t lane = 0; lane < numLanes; ++lane)
+		x[lane] *= inverseDiagonal;
+}
@@ -54,7 +54,7 @@ int main()
 	input.name("Input");
 	dynamic.name("Dynamic");
 	post.name("Post");
-	dumpToFile(taskflow, "./succeeds_parent_task.dot");
+	exportGraph(taskflow, "./succeeds_parent_task.dot");
 
 	return 0;
 }
@@ -0,0 +1,251 @@
+#pragma once
+
+// Standard library includes.
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/// Records the progress of an iterative solver without allocating or doing I/O on the solver's
+/// critical path.
+///
+/// Samples are written to a ring buffer allocated up front, stored structure-of-arrays so that a
+/// sample is a handful of scattered stores and a drain is a few contiguous writes. Only every
+/// `every`-th iteration is sampled, and only the first `numElements` elements of the solution
+/// vector are kept, zero meaning norm only.
+///
+/// If a drain path is given a background thread writes samples to that file once the ring buffer
+/// is half full, and when the recorder is closed. Without a drain path the first `capacity`
+/// samples are kept in memory for the caller to read back. In both cases samples that
+/// arrive while the ring buffer is full are dropped and counted, the solver is never blocked.
+///
+/// The ring buffer is single-producer, single-consumer: `record` must only be called from one task
+/// at a time, which holds for a task in a Taskflow loop.
+///
+/// Drain file format, all values native endian:
+///   Header: char[4] "TRAJ", uint32 version = 1, uint64 numElements.
+///   Blocks: uint64 count, uint64 iterations[count], double residualNorms[count],
+///           double x[count][numElements].
+class TrajectoryRecorder
+{
+public:
+	struct Options
+	{
+		// Must be at least one.
+		std::size_t capacity {1024};
+		std::size_t every {1};
+		std::size_t numElements {0};
+		std::filesystem::path drainPath {};
+	};
+
+	explicit TrajectoryRecorder(const Options& options)
+		: m_options(options)
+		, m_iterations(options.capacity)
+		, m_residualNorms(options.capacity)
+		, m_x(options.capacity * options.numElements)
+	{
+		m_options.every = std::max<std::size_t>(m_options.every, 1);
+		if (!m_options.drainPath.empty())
+		{
+			errno = 0;
+			m_file.open(m_options.drainPath, std::ios_base::binary | std::ios_base::trunc);
+			if (!m_file)
+			{
+				std::cerr << "TrajectoryRecorder: Could not open " << m_options.drainPath << ": "
+						  << strerror(errno) << '\n';
+				m_drainFailed.store(true, std::memory_order_release);
+				return;
+			}
+			const std::uint32_t version {1};
+			const std::uint64_t numElements {m_options.numElements};
+			m_file.write("TRAJ", 4);
+			write(&version, 1);
+			write(&numElements, 1);
+			if (!m_file.flush())
+			{
+				failDrain();
+				return;
+			}
+			m_drainer = std::thread([this]() { drainLoop(); });
+		}
+	}
+
+	~TrajectoryRecorder()
+	{
+		close();
+	}
+
+	TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+	TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+	/// Record iteration `iteration` if it is sampled. `x` must have at least `numElements` elements.
+	void record(std::uint64_t iteration, double residualNorm, const double* x)
+	{
+		if (iteration % m_options.every != 0)
+			return;
+
+		const std::uint64_t head = m_head.load(std::memory_order_relaxed);
+		const std::uint64_t tail = m_tail.load(std::memory_order_acquire);
+		if (head - tail == m_options.capacity)
+		{
+			++m_numDropped;
+			return;
+		}
+
+		const std::size_t slot = head % m_options.capacity;
+		m_iterations[slot] = iteration;
+		m_residualNorms[slot] = residualNorm;
+		std::copy_n(x, m_options.numElements, m_x.data() + slot * m_options.numElements);
+		m_head.store(head + 1, std::memory_order_release);
+
+		if (m_drainer.joinable() && head + 1 - tail == m_options.capacity / 2 + 1)
+			wakeDrainer();
+	}
+
+	/// Write any remaining samples and stop the drain thread. Called by the destructor.
+	void close()
+	{
+		if (!m_drainer.joinable())
+			return;
+		m_closing.store(true, std::memory_order_release);
+		wakeDrainer();
+		m_drainer.join();
+		m_file.close();
+		if (!m_file && !drainFailed())
+			failDrain();
+	}
+
+	/// Whether the drain file couldn't be opened or written. Can be read while recording. From
+	/// then on samples are no longer drained but stay in memory, as without a drain path, and
+	/// those arriving once the ring buffer is full are dropped.
+	bool drainFailed() const
+	{
+		return m_drainFailed.load(std::memory_order_acquire);
+	}
+
+	/// Number of samples held in memory. Always zero after close when draining to a file.
+	std::size_t numSamples() const
+	{
+		return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+	}
+
+	std::uint64_t iteration(std::size_t sample) const
+	{
+		return m_iterations[slotOf(sample)];
+	}
+
+	double residualNorm(std::size_t sample) const
+	{
+		return m_residualNorms[slotOf(sample)];
+	}
+
+	const double* x(std::size_t sample) const
+	{
+		return m_x.data() + slotOf(sample) * m_options.numElements;
+	}
+
+	std::size_t numElements() const
+	{
+		return m_options.numElements;
+	}
+
+	std::size_t numDropped() const
+	{
+		return m_numDropped;
+	}
+
+	const std::filesystem::path& drainPath() const
+	{
+		return m_options.drainPath;
+	}
+
+private:
+	std::size_t slotOf(std::size_t sample) const
+	{
+		return (m_tail.load(std::memory_order_acquire) + sample) % m_options.capacity;
+	}
+
+	void failDrain()
+	{
+		std::cerr << "TrajectoryRecorder: Could not write " << m_options.drainPath << '\n';
+		m_drainFailed.store(true, std::memory_order_release);
+	}
+
+	void wakeDrainer()
+	{
+		m_wakeups.fetch_add(1, std::memory_order_release);
+		m_wakeups.notify_one();
+	}
+
+	void drainLoop()
+	{
+		std::uint64_t seenWakeups {0};
+		while (true)
+		{
+			m_wakeups.wait(seenWakeups, std::memory_order_acquire);
+			seenWakeups = m_wakeups.load(std::memory_order_acquire);
+			const bool closing = m_closing.load(std::memory_order_acquire);
+			drain();
+			if (closing)
+				return;
+		}
+	}
+
+	// Write all samples in [tail, head) as at most two blocks, one per contiguous slot range. The
+	// slots are only given back once the file took them, a failed write leaves them in memory.
+	void drain()
+	{
+		if (drainFailed())
+			return;
+		const std::uint64_t head = m_head.load(std::memory_order_acquire);
+		std::uint64_t tail = m_tail.load(std::memory_order_relaxed);
+		while (tail != head)
+		{
+			const std::size_t begin = tail % m_options.capacity;
+			const std::size_t end =
+				std::min<std::size_t>(m_options.capacity, begin + std::size_t(head - tail));
+			const std::uint64_t count {end - begin};
+			write(&count, 1);
+			write(m_iterations.data() + begin, count);
+			write(m_residualNorms.data() + begin, count);
+			write(m_x.data() + begin * m_options.numElements, count * m_options.numElements);
+			tail += count;
+		}
+		if (!m_file.flush())
+		{
+			failDrain();
+			return;
+		}
+		m_tail.store(tail, std::memory_order_release);
+	}
+
+	template <typename T>
+	void write(const T* data, std::size_t count)
+	{
+		m_file.write(reinterpret_cast<const char*>(data), std::streamsize(count * sizeof(T)));
+	}
+
+	Options m_options;
+	std::vector<std::uint64_t> m_iterations;
+	std::vector<double> m_residualNorms;
+	std::vector<double> m_x;
+
+	// Monotonically increasing sample counters, the slot of a sample is its counter modulo the
+	// capacity. Written by the producer and the drain thread respectively.
+	std::atomic<std::uint64_t> m_head {0};
+	std::atomic<std::uint64_t> m_tail {0};
+	std::size_t m_numDropped {0};
+
+	std::ofstream m_file;
+	std::atomic<bool> m_drainFailed {false};
+	std::thread m_drainer;
+	std::atomic<std::uint64_t> m_wakeups {0};
+	std::atomic<bool> m_closing {false};
+};
@@ -1,69 +1,464 @@
+#include "bulk_spawn.h"
+#include "collision.h"
+#include "perf_counters.h"
 #include "utils.h"
 #include "taskflow/taskflow.hpp"
+#include "taskflow/algorithm/for_each.hpp"
+#include "taskflow/algorithm/sort.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+// Collision detection between spheres and boxes scattered in a cube. The broad phase finds the
+// pairs whose bounding boxes overlap, and the near phase only spawns tasks for the kinds of pairs
+// the broad phase found, so the work done is the work needed. The near phase computes contacts
+// with the widest vector kernels the CPU has, see collision.h, and each worker appends to its own
+// contact lists so that they need no locking.
+//
+// The near-phase pairs are split into chunks of about equal time by a cost model of each kind of
+// pair, so the expensive box-box pairs are cut finer than sphere-sphere pairs and every worker
+// gets a share of each. The model learns from the time the chunks took, so it is run for several
+// frames with the bodies moving a little in between.
+//
+// Usage:
+//   work_if_needed [num spheres] [num boxes] [num frames]
 
 class Space
 {
 public:
+	Space(
+		std::size_t numSpheres, std::size_t numBoxes, std::uint32_t seed,
+		const tf::Executor& executor);
+
 	void emplaceTasks(tf::Taskflow& taskflow);
 
-	void broadPhase();
+	void broadPhase(tf::Subflow& subflow);
 	void nearPhase(tf::Subflow& subflow);
-	void nearPhaseSphereSphere();
-	void nearPhaseSphereBox();
-	void nearPhaseBoxBox();
+	void nearPhaseSphereSphere(std::size_t begin, std::size_t end);
+	void nearPhaseSphereBox(std::size_t begin, std::size_t end);
+	void nearPhaseBoxBox(std::size_t begin, std::size_t end);
+	void updateCostModel();
+
+	/// Move every body by up to maxDistance along each axis, for the next frame.
+	void moveBodies(float maxDistance);
+
+	const PairLists& pairs() const
+	{
+		return m_pairs;
+	}
+
+	/// Append the contacts of the last run, from the lists of all workers.
+	void collectContacts(ContactLists& contacts) const;
+
+	const NearPhaseCostModel& costModel() const
+	{
+		return m_costModel;
+	}
+
+	/// Pairs per near-phase chunk in the last run, indexed by PairType.
+	const std::array<std::size_t, s_numPairTypes>& chunkSizes() const
+	{
+		return m_chunkSizes;
+	}
+
+	std::size_t numNearChunks() const
+	{
+		return std::accumulate(m_numNearChunks.begin(), m_numNearChunks.end(), std::size_t {0});
+	}
+
+	/// The near-phase time of the busiest worker over the mean of all workers in the last run, 1
+	/// when perfectly balanced.
+	double nearPhaseImbalance() const
+	{
+		return m_nearPhaseImbalance;
+	}
 
 private:
-	int m_numSphereSperePairs {0};
-	int m_numSphereBoxPairs {0};
-	int m_numBoxBoxPairs {0};
+	// Positions in the sorted order swept by one task.
+	static constexpr std::size_t s_sweepChunkSize {256};
+	// Bodies whose bounding boxes one task computes.
+	static constexpr std::size_t s_aabbChunkSize {1024};
+	// Near-phase chunks per worker, enough for the workers that finish early to take work from
+	// the others when the cost model is off.
+	static constexpr std::size_t s_nearChunksPerWorker {4};
+	// No chunk is expected to take less, so that scheduling stays a small part of it.
+	static constexpr double s_minNearChunkNanoseconds {20'000.0};
+	// Chunk sizes are rounded up to a multiple of the widest kernel, to fill its batches.
+	static constexpr std::size_t s_nearChunkAlignment {16};
+
+	// The time a worker spent on the pairs of one type.
+	struct NearPhaseTiming
+	{
+		double seconds {0.0};
+		std::size_t numPairs {0};
+	};
+
+	// Padded to a cache line so that workers appending to neighboring lists don't share one.
+	struct alignas(64) WorkerState
+	{
+		ContactLists contacts;
+		std::array<NearPhaseTiming, s_numPairTypes> timings;
+	};
+
+	std::size_t numBodies() const
+	{
+		return m_spheres.size() + m_boxes.size();
+	}
+
+	WorkerState& workerState()
+	{
+		return m_workerStates[std::size_t(m_executor.this_worker_id())];
+	}
+
+	ContactLists& workerContacts()
+	{
+		return workerState().contacts;
+	}
+
+	void splitNearPhase();
+	void runNearChunk(PairType type, std::size_t chunk);
+
+	Spheres m_spheres;
+	Boxes m_boxes;
+	Aabbs m_aabbs;
+	// Body numbers sorted by the lower bound of their bounding box along m_axis.
+	std::vector<std::uint32_t> m_order;
+	std::size_t m_axis {0};
+	// The pairs every sweep task found, merged into m_pairs.
+	std::vector<PairLists> m_chunkPairs;
+	PairLists m_pairs;
+	const tf::Executor& m_executor;
+	// Indexed by worker id, cleared but not freed every run.
+	std::vector<WorkerState> m_workerStates;
+	NearPhaseCostModel m_costModel;
+	std::array<std::size_t, s_numPairTypes> m_chunkSizes {};
+	std::array<std::size_t, s_numPairTypes> m_numNearChunks {};
+	// The most expensive type first.
+	std::array<PairType, s_numPairTypes> m_nearPhaseOrder {
+		PairType::SphereSphere, PairType::SphereBox, PairType::BoxBox};
+	double m_nearPhaseImbalance {1.0};
+	std::mt19937 m_generator;
 };
 
+Space::Space(
+	std::size_t numSpheres, std::size_t numBoxes, std::uint32_t seed, const tf::Executor& executor)
+	: m_executor(executor), m_workerStates(executor.num_workers()), m_generator(seed)
+{
+	std::mt19937& generator = m_generator;
+	// About one body per 64 units of volume, which gives a few neighbors per body.
+	const float side = 4.0f * std::cbrt(float(std::max<std::size_t>(numSpheres + numBoxes, 1)));
+	std::uniform_real_distribution<float> position(0.0f, side);
+	std::uniform_real_distribution<float> size(0.5f, 1.5f);
+	std::normal_distribution<float> normal;
+
+	m_spheres.resize(numSpheres);
+	for (std::size_t i = 0; i < numSpheres; ++i)
+	{
+		m_spheres.x[i] = position(generator);
+		m_spheres.y[i] = position(generator);
+		m_spheres.z[i] = position(generator);
+		m_spheres.radius[i] = size(generator);
+	}
+
+	m_boxes.resize(numBoxes);
+	for (std::size_t i = 0; i < numBoxes; ++i)
+	{
+		m_boxes.x[i] = position(generator);
+		m_boxes.y[i] = position(generator);
+		m_boxes.z[i] = position(generator);
+		m_boxes.halfX[i] = size(generator);
+		m_boxes.halfY[i] = size(generator);
+		m_boxes.halfZ[i] = size(generator);
+		// A uniformly random rotation, from a normalized 4D Gaussian quaternion.
+		float w = normal(generator), x = normal(generator), y = normal(generator),
+			  z = normal(generator);
+		const float length = std::sqrt(w * w + x * x + y * y + z * z);
+		w /= length, x /= length, y /= length, z /= length;
+		const float R[9] {
+			1 - 2 * (y * y + z * z), 2 * (x * y - w * z),     2 * (x * z + w * y),
+			2 * (x * y + w * z),     1 - 2 * (x * x + z * z), 2 * (y * z - w * x),
+			2 * (x * z - w * y),     2 * (y * z + w * x),     1 - 2 * (x * x + y * y)};
+		for (std::size_t k = 0; k < 9; ++k)
+			m_boxes.rotation[k][i] = R[k];
+	}
+}
+
 void Space::emplaceTasks(tf::Taskflow& taskflow)
 {
-	tf::Task broadPhaseTask = taskflow.emplace([this]() { broadPhase(); });
+	tf::Task broadPhaseTask = taskflow.emplace([this](tf::Subflow& subflow) { broadPhase(subflow); });
 	broadPhaseTask.name("Broad-Phase");
 	tf::Task nearPhasesTask = taskflow.emplace([this](tf::Subflow& subflow) { nearPhase(subflow); });
 	nearPhasesTask.name("Near-Phase");
 	broadPhaseTask.precede(nearPhasesTask);
 }
 
-void Space::broadPhase()
+void Space::broadPhase(tf::Subflow& subflow)
 {
-	m_numSphereSperePairs = 1;
-	m_numSphereBoxPairs = 0;
-	m_numBoxBoxPairs = 1;
+	const std::size_t n = numBodies();
+	m_aabbs.resize(n);
+	// The sort task is given the range now, so the order is sized before it runs.
+	m_order.resize(n);
+	m_chunkPairs.resize((n + s_sweepChunkSize - 1) / s_sweepChunkSize);
+
+	tf::Task computeAabbs = subflow.for_each_index(
+		std::size_t {0}, n, s_aabbChunkSize,
+		[this, n](std::size_t begin)
+		{
+			::computeAabbs(
+				m_spheres, m_boxes, m_aabbs, begin, std::min(begin + s_aabbChunkSize, n));
+		});
+	tf::Task chooseAxis = subflow.emplace(
+		[this]()
+		{
+			m_axis = principalAxis(m_aabbs);
+			std::iota(m_order.begin(), m_order.end(), std::uint32_t {0});
+		});
+	tf::Task sort = subflow.sort(
+		m_order.begin(), m_order.end(), [this](std::uint32_t a, std::uint32_t b)
+		{ return m_aabbs.min[m_axis][a] < m_aabbs.min[m_axis][b]; });
+	tf::Task sweep = subflow.for_each_index(
+		std::size_t {0}, m_chunkPairs.size(), std::size_t {1},
+		[this, n](std::size_t chunk)
+		{
+			const std::size_t begin = chunk * s_sweepChunkSize;
+			m_chunkPairs[chunk].clear();
+			sweepAndPrune(
+				m_aabbs, m_order, m_axis, m_spheres.size(), begin,
+				std::min(begin + s_sweepChunkSize, n), m_chunkPairs[chunk]);
+		});
+	tf::Task mergePairs = subflow.emplace(
+		[this]()
+		{
+			m_pairs.clear();
+			for (const PairLists& pairs : m_chunkPairs)
+				m_pairs.append(pairs);
+		});
+
+	computeAabbs.precede(chooseAxis);
+	chooseAxis.precede(sort);
+	sort.precede(sweep);
+	sweep.precede(mergePairs);
+
+	computeAabbs.name("Compute AABBs");
+	chooseAxis.name("Choose axis");
+	sort.name("Sort");
+	sweep.name("Sweep and prune");
+	mergePairs.name("Merge pairs");
 }
 
 void Space::nearPhase(tf::Subflow& subflow)
 {
 	subflow.retain(true);
-	if (m_numSphereSperePairs > 0)
-		subflow.emplace([this]() { nearPhaseSphereSphere(); }).name("Sphere-Sphere");
-	if (m_numSphereBoxPairs > 0)
-		subflow.emplace([this]() { nearPhaseSphereBox(); }).name("Sphere-Box");
-	if (m_numBoxBoxPairs > 0)
-		subflow.emplace([this]() { nearPhaseBoxBox(); }).name("Box-Box");
+	for (WorkerState& state : m_workerStates)
+	{
+		state.contacts.clear();
+		state.timings = {};
+	}
+	splitNearPhase();
+	if (numNearChunks() == 0)
+	{
+		m_nearPhaseImbalance = 1.0;
+		return;
+	}
+
+	// One task per type found, all running at once, so that traces and counters show each type on
+	// its own. Each worker claims one chunk at a time, they are already sized for balance.
+	static constexpr std::array<const char*, s_numPairTypes> names {
+		"Sphere-Sphere", "Sphere-Box", "Box-Box"};
+	tf::Task updateCostModel = subflow.emplace([this]() { this->updateCostModel(); });
+	updateCostModel.name("Update cost model");
+	for (PairType type : m_nearPhaseOrder)
+	{
+		if (m_numNearChunks[std::size_t(type)] == 0)
+			continue;
+		tf::Task contacts = spawnChunked(
+			subflow, m_numNearChunks[std::size_t(type)],
+			[this, type](std::size_t chunk) { runNearChunk(type, chunk); },
+			{Partitioning::Dynamic, 1});
+		contacts.precede(updateCostModel);
+		contacts.name(names[std::size_t(type)]);
+	}
+}
+
+void Space::splitNearPhase()
+{
+	const std::array<std::size_t, s_numPairTypes> numPairs {
+		m_pairs.sphereSphere.size(), m_pairs.sphereBox.size(), m_pairs.boxBox.size()};
+	double totalNanoseconds {0.0};
+	for (std::size_t type = 0; type < s_numPairTypes; ++type)
+		totalNanoseconds += double(numPairs[type]) * m_costModel.cost(PairType(type));
+	const double chunkNanoseconds = std::max(
+		totalNanoseconds / double(s_nearChunksPerWorker * m_workerStates.size()),
+		s_minNearChunkNanoseconds);
+
+	// Expensive types first, so that the cheap ones fill in the gaps at the end.
+	std::sort(
+		m_nearPhaseOrder.begin(), m_nearPhaseOrder.end(),
+		[this](PairType a, PairType b) { return m_costModel.cost(a) > m_costModel.cost(b); });
+
+	for (PairType type : m_nearPhaseOrder)
+	{
+		const std::size_t n = numPairs[std::size_t(type)];
+		const double pairsPerChunk = std::ceil(chunkNanoseconds / m_costModel.cost(type));
+		// Capped before the conversion, a tiny measured cost could make it overflow.
+		std::size_t chunkSize = std::size_t(std::min(pairsPerChunk, double(n)));
+		chunkSize = std::max<std::size_t>(
+			(chunkSize + s_nearChunkAlignment - 1) / s_nearChunkAlignment * s_nearChunkAlignment,
+			s_nearChunkAlignment);
+		m_chunkSizes[std::size_t(type)] = chunkSize;
+		m_numNearChunks[std::size_t(type)] = (n + chunkSize - 1) / chunkSize;
+	}
 }
 
-void Space::nearPhaseSphereSphere()
+void Space::runNearChunk(PairType type, std::size_t chunk)
 {
+	const std::array<std::size_t, s_numPairTypes> numPairs {
+		m_pairs.sphereSphere.size(), m_pairs.sphereBox.size(), m_pairs.boxBox.size()};
+	const std::size_t chunkSize = m_chunkSizes[std::size_t(type)];
+	const std::size_t begin = chunk * chunkSize;
+	const std::size_t end = std::min(begin + chunkSize, numPairs[std::size_t(type)]);
+	const auto start = std::chrono::steady_clock::now();
+	switch (type)
+	{
+	case PairType::SphereSphere:
+		nearPhaseSphereSphere(begin, end);
+		break;
+	case PairType::SphereBox:
+		nearPhaseSphereBox(begin, end);
+		break;
+	case PairType::BoxBox:
+		nearPhaseBoxBox(begin, end);
+		break;
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	NearPhaseTiming& timing = workerState().timings[std::size_t(type)];
+	timing.seconds += elapsed.count();
+	timing.numPairs += end - begin;
 }
-void Space::nearPhaseSphereBox()
+
+void Space::nearPhaseSphereSphere(std::size_t begin, std::size_t end)
+{
+	collisionKernels().sphereSphere(
+		m_spheres, m_pairs.sphereSphere.data() + begin, end - begin,
+		workerContacts().sphereSphere);
+}
+
+void Space::nearPhaseSphereBox(std::size_t begin, std::size_t end)
 {
+	collisionKernels().sphereBox(
+		m_spheres, m_boxes, m_pairs.sphereBox.data() + begin, end - begin,
+		workerContacts().sphereBox);
 }
-void Space::nearPhaseBoxBox()
+
+void Space::nearPhaseBoxBox(std::size_t begin, std::size_t end)
 {
+	collisionKernels().boxBox(
+		m_boxes, m_pairs.boxBox.data() + begin, end - begin, workerContacts().boxBox);
 }
 
-int main()
+void Space::updateCostModel()
 {
+	std::array<NearPhaseTiming, s_numPairTypes> total;
+	double busiest {0.0};
+	double sum {0.0};
+	for (const WorkerState& state : m_workerStates)
+	{
+		double busy {0.0};
+		for (std::size_t type = 0; type < s_numPairTypes; ++type)
+		{
+			total[type].seconds += state.timings[type].seconds;
+			total[type].numPairs += state.timings[type].numPairs;
+			busy += state.timings[type].seconds;
+		}
+		busiest = std::max(busiest, busy);
+		sum += busy;
+	}
+	for (std::size_t type = 0; type < s_numPairTypes; ++type)
+		m_costModel.update(PairType(type), total[type].seconds, total[type].numPairs);
+	m_nearPhaseImbalance = sum > 0.0 ? busiest * double(m_workerStates.size()) / sum : 1.0;
+}
+
+void Space::moveBodies(float maxDistance)
+{
+	std::uniform_real_distribution<float> offset(-maxDistance, maxDistance);
+	for (std::vector<float>* coordinates :
+		 {&m_spheres.x, &m_spheres.y, &m_spheres.z, &m_boxes.x, &m_boxes.y, &m_boxes.z})
+	{
+		for (float& coordinate : *coordinates)
+			coordinate += offset(m_generator);
+	}
+}
+
+void Space::collectContacts(ContactLists& contacts) const
+{
+	for (const WorkerState& state : m_workerStates)
+		contacts.append(state.contacts);
+}
+
+// Set TASK_COUNTERS to print hardware event counts by task, and COLLISION_KERNELS to scalar, avx2
+// or avx512 to force a version of the near-phase kernels.
+int main(int argc, char** argv)
+{
+	std::size_t num_spheres {20'000};
+	std::size_t num_boxes {10'000};
+	if (argc > 1)
+		num_spheres = std::stoul(argv[1]);
+	if (argc > 2)
+		num_boxes = std::stoul(argv[2]);
+	int num_frames {10};
+	if (argc > 3)
+		num_frames = std::stoi(argv[3]);
+
 	tf::Executor executor;
+	countIfRequested(executor);
 	tf::Taskflow taskflow;
 	taskflow.name("Dynamic Tasks");
 
-	Space space;
+	Space space(num_spheres, num_boxes, 1, executor);
 	space.emplaceTasks(taskflow);
-	executor.run(taskflow).wait();
+	std::cout << "Bodies: " << num_spheres << " spheres, " << num_boxes << " boxes, "
+			  << collisionKernels().name << " kernels, " << executor.num_workers() << " workers\n";
+	std::cout << std::setw(6) << "Frame" << std::setw(11) << "Time [ms]" << std::setw(8) << "Chunks"
+			  << std::setw(24) << "Pairs per chunk" << std::setw(30) << "Cost per pair [ns]"
+			  << std::setw(11) << "Imbalance" << '\n';
+	for (int frame = 0; frame < num_frames; ++frame)
+	{
+		if (frame > 0)
+			space.moveBodies(0.05f);
+		const auto start = std::chrono::steady_clock::now();
+		executor.run(taskflow).wait();
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		// The chunk sizes this frame used, and the costs learned from it for the next one.
+		const std::array<std::size_t, s_numPairTypes>& sizes = space.chunkSizes();
+		const NearPhaseCostModel& model = space.costModel();
+		std::cout << std::setw(6) << frame << std::fixed << std::setprecision(2) << std::setw(11)
+				  << elapsed.count() * 1e3 << std::setw(8) << space.numNearChunks() << std::setw(8)
+				  << sizes[0] << std::setw(8) << sizes[1] << std::setw(8) << sizes[2]
+				  << std::setw(10) << model.nanosecondsPerPair[0] << std::setw(10)
+				  << model.nanosecondsPerPair[1] << std::setw(10) << model.nanosecondsPerPair[2]
+				  << std::setw(11) << space.nearPhaseImbalance() << '\n';
+	}
+	std::cout << "Pairs per chunk and cost per pair are for sphere-sphere, sphere-box and "
+				 "box-box.\n";
+
+	const PairLists& pairs = space.pairs();
+	std::cout << "Pairs: " << pairs.sphereSphere.size() << " sphere-sphere, "
+			  << pairs.sphereBox.size() << " sphere-box, " << pairs.boxBox.size() << " box-box\n";
+	ContactLists contacts;
+	space.collectContacts(contacts);
+	std::cout << "Contacts: " << contacts.sphereSphere.size() << " sphere-sphere, "
+			  << contacts.sphereBox.size() << " sphere-box, " << contacts.boxBox.size()
+			  << " box-box\n";
 
 	dumpToFile(taskflow, "work_if_needed.dot");
 }